@@ -0,0 +1,153 @@
+/** © Copyright 2024 CERN
+ *
+ * This software is distributed under the terms of the
+ * GNU Lesser General Public Licence version 3 (LGPL Version 3),
+ * copied verbatim in the file “LICENSE”
+ *
+ * In applying this licence, CERN does not waive the privileges
+ * and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * Author: Alexandru Savulescu (HSE)
+ *
+ **/
+
+#include "BufferPool.hxx"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace Common {
+
+    std::mutex BufferPool::_mutex;
+    std::vector<std::unique_ptr<BufferPool::Chunk>> BufferPool::_free;
+    std::atomic<uint64_t> BufferPool::_allocations{0};
+    std::atomic<uint64_t> BufferPool::_reuses{0};
+
+    BufferPool::Chunk* BufferPool::acquire(size_t capacity)
+    {
+        {
+            std::lock_guard lock{_mutex};
+            // Most recently released first: its memory is the most likely to still be in cache
+            for(auto it = _free.rbegin(); it != _free.rend(); ++it) {
+                if((*it)->capacity >= capacity) {
+                    auto chunk = it->release();
+                    _free.erase(std::next(it).base());
+                    chunk->refs.store(1, std::memory_order_relaxed);
+                    _reuses.fetch_add(1, std::memory_order_relaxed);
+                    return chunk;
+                }
+            }
+        }
+
+        auto chunk = new Chunk;
+        chunk->capacity = std::max(capacity, MIN_CHUNK_SIZE);
+        chunk->data.reset(new char[chunk->capacity]);
+        chunk->refs.store(1, std::memory_order_relaxed);
+        _allocations.fetch_add(1, std::memory_order_relaxed);
+        return chunk;
+    }
+
+    void BufferPool::release(Chunk* chunk)
+    {
+        if(chunk->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+        {
+            std::lock_guard lock{_mutex};
+            if(_free.size() < MAX_FREE_CHUNKS) {
+                _free.emplace_back(chunk);
+                return;
+            }
+        }
+        delete chunk;
+    }
+
+    size_t BufferPool::freeChunks()
+    {
+        std::lock_guard lock{_mutex};
+        return _free.size();
+    }
+
+    BufferPool::Slice::Slice(Chunk* chunk, char* data, size_t size)
+        : _chunk(chunk), _data(data), _size(size)
+    {
+        _chunk->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    BufferPool::Slice::Slice(const Slice& other)
+        : _chunk(other._chunk), _data(other._data), _size(other._size)
+    {
+        if(_chunk) {
+            _chunk->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    BufferPool::Slice::Slice(Slice&& other) noexcept
+        : _chunk(std::exchange(other._chunk, nullptr)), _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0))
+    {
+    }
+
+    BufferPool::Slice& BufferPool::Slice::operator=(const Slice& other)
+    {
+        if(this != &other) {
+            Slice copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    BufferPool::Slice& BufferPool::Slice::operator=(Slice&& other) noexcept
+    {
+        if(this != &other) {
+            reset();
+            _chunk = std::exchange(other._chunk, nullptr);
+            _data = std::exchange(other._data, nullptr);
+            _size = std::exchange(other._size, 0);
+        }
+        return *this;
+    }
+
+    BufferPool::Slice::~Slice()
+    {
+        reset();
+    }
+
+    void BufferPool::Slice::reset()
+    {
+        if(_chunk) {
+            release(_chunk);
+        }
+        _chunk = nullptr;
+        _data = nullptr;
+        _size = 0;
+    }
+
+    BufferPool::Slice BufferPool::Slice::copyOf(const void* data, size_t size)
+    {
+        Arena arena(size);
+        auto slice = arena.allocate(size);
+        std::memcpy(slice.data(), data, size);
+        return slice;
+    }
+
+    BufferPool::Arena::Arena(size_t capacity)
+        : _chunk(acquire(capacity))
+    {
+    }
+
+    BufferPool::Arena::~Arena()
+    {
+        release(_chunk);
+    }
+
+    BufferPool::Slice BufferPool::Arena::allocate(size_t size)
+    {
+        if(_used + size > _chunk->capacity) {
+            return Slice();
+        }
+        Slice slice(_chunk, _chunk->data.get() + _used, size);
+        _used += size;
+        return slice;
+    }
+}
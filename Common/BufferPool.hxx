@@ -0,0 +1,116 @@
+/** © Copyright 2024 CERN
+ *
+ * This software is distributed under the terms of the
+ * GNU Lesser General Public Licence version 3 (LGPL Version 3),
+ * copied verbatim in the file “LICENSE”
+ *
+ * In applying this licence, CERN does not waive the privileges
+ * and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * Author: Alexandru Savulescu (HSE)
+ *
+ **/
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace Common {
+
+/*!
+ * \class BufferPool
+ * \brief Pool of refcounted memory chunks carrying the values sent to WinCC OA.
+ *
+ * A producer (e.g. a poll cycle) takes one chunk sized for all its values through an Arena, and carves a Slice per value.
+ * The slices travel through the toDP queue, and the chunk goes back to the pool once the last slice was consumed by workProc.
+ * In steady state the chunks are reused and values cost no heap allocation; allocations() and reuses() tell whether this holds.
+ */
+class BufferPool{
+private:
+    struct Chunk
+    {
+        std::unique_ptr<char[]> data;
+        size_t capacity{0};
+        std::atomic<uint32_t> refs{0};
+    };
+
+public:
+    class Arena;
+
+    /*!
+     * \class Slice
+     * \brief A part of a pooled chunk. Copies share the chunk, which is released with the last of them.
+     */
+    class Slice{
+    public:
+        Slice() = default;
+        Slice(const Slice& other);
+        Slice(Slice&& other) noexcept;
+        Slice& operator=(const Slice& other);
+        Slice& operator=(Slice&& other) noexcept;
+        ~Slice();
+
+        char* data() const { return _data; }
+        size_t size() const { return _size; }
+
+        // A slice holding a copy of size bytes of data, in a chunk of its own
+        static Slice copyOf(const void* data, size_t size);
+
+    private:
+        friend class BufferPool;
+        friend class Arena;
+        Slice(Chunk* chunk, char* data, size_t size);
+        void reset();
+
+        Chunk* _chunk{nullptr};
+        char* _data{nullptr};
+        size_t _size{0};
+    };
+
+    /*!
+     * \class Arena
+     * \brief Takes one chunk from the pool and carves consecutive slices out of it
+     */
+    class Arena{
+    public:
+        // capacity: total size of the slices that will be allocated
+        explicit Arena(size_t capacity);
+        ~Arena();
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        // Returns an empty slice once the capacity is exhausted
+        Slice allocate(size_t size);
+
+    private:
+        Chunk* _chunk;
+        size_t _used{0};
+    };
+
+    // Number of chunks allocated from the heap
+    static uint64_t allocations() { return _allocations.load(std::memory_order_relaxed); }
+    // Number of chunks taken back from the pool
+    static uint64_t reuses() { return _reuses.load(std::memory_order_relaxed); }
+    // Number of chunks currently free in the pool
+    static size_t freeChunks();
+
+private:
+    static Chunk* acquire(size_t capacity);
+    static void release(Chunk* chunk);
+
+    static constexpr size_t MIN_CHUNK_SIZE = 4096;
+    static constexpr size_t MAX_FREE_CHUNKS = 256;
+
+    static std::mutex _mutex;
+    static std::vector<std::unique_ptr<Chunk>> _free;
+    static std::atomic<uint64_t> _allocations;
+    static std::atomic<uint64_t> _reuses;
+};
+
+}//namespace
@@ -0,0 +1,95 @@
+/** © Copyright 2024 CERN
+ *
+ * This software is distributed under the terms of the
+ * GNU Lesser General Public Licence version 3 (LGPL Version 3),
+ * copied verbatim in the file “LICENSE”
+ *
+ * In applying this licence, CERN does not waive the privileges
+ * and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * Author: Alexandru Savulescu (HSE)
+ *
+ **/
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace Common{
+
+    /*!
+    * \class ChangeDetector
+    * \brief Compares two memory images block by block, producing a bitmap of the blocks that changed.
+    * Used for smoothing: one pass over the buffer of a read group instead of one memcmp per variable.
+    */
+    class ChangeDetector{
+        public:
+            static constexpr size_t BLOCK_SIZE = 16;    // bytes per bit of the dirty bitmap
+
+            // Size to give to the images so that they are made of whole blocks
+            static size_t PaddedSize(size_t size)
+            {
+                return (size + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+            }
+
+            /**
+             * @brief Sets in dirty one bit per block that differs between current and previous
+             * @param size : size of both images, a multiple of BLOCK_SIZE (see PaddedSize)
+             * @return whether any block differs
+             */
+            static bool Compare(const char* current, const char* previous, size_t size, std::vector<uint64_t>& dirty)
+            {
+                const size_t blocks = size / BLOCK_SIZE;
+                dirty.assign((blocks + 63) / 64, 0);
+                uint64_t any = 0;
+                for(size_t word = 0; word < dirty.size(); ++word) {
+                    const size_t first = word * 64;
+                    const size_t last = std::min(blocks, first + 64);
+                    uint64_t bits = 0;
+                    for(size_t block = first; block < last; ++block) {
+                        bits |= static_cast<uint64_t>(BlockDiffers(current + block * BLOCK_SIZE, previous + block * BLOCK_SIZE)) << (block - first);
+                    }
+                    dirty[word] = bits;
+                    any |= bits;
+                }
+                return any != 0;
+            }
+
+            // Whether any block holding the bytes [offset, offset + size) is dirty
+            static bool IsDirty(const std::vector<uint64_t>& dirty, size_t offset, size_t size)
+            {
+                const size_t last = (offset + (size ? size - 1 : 0)) / BLOCK_SIZE;
+                for(size_t block = offset / BLOCK_SIZE; block <= last; ++block) {
+                    if((dirty[block / 64] >> (block % 64)) & 1) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+        private:
+            static bool BlockDiffers(const char* a, const char* b)
+            {
+#ifdef __SSE2__
+                const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+                const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+                return _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xFFFF;
+#else
+                uint64_t a0, a1, b0, b1;
+                std::memcpy(&a0, a, 8);
+                std::memcpy(&a1, a + 8, 8);
+                std::memcpy(&b0, b, 8);
+                std::memcpy(&b1, b + 8, 8);
+                return ((a0 ^ b0) | (a1 ^ b1)) != 0;
+#endif
+            }
+    }; //class ChangeDetector
+} //namespace Common
@@ -24,9 +24,24 @@ namespace Common {
     uint32_t Constants::DRV_NO = 0;                         // Read from PVSS on driver startup
     uint32_t Constants::TSAP_PORT_LOCAL = 0;                // Read from PVSS on driver startup from config file
     uint32_t Constants::TSAP_PORT_REMOTE = 0;               // Read from PVSS on driver startupconfig file
-    uint32_t Constants::POLLING_INTERVAL = 2;               // Read from PVSS on driver startupconfig file, default 2 seconds
+    std::chrono::milliseconds Constants::POLLING_INTERVAL = std::chrono::seconds(2);   // Read from PVSS on driver startupconfig file, default 2 seconds
     uint32_t Constants::MAX_IO_FAILURES = 1;                // Read from PVSS on driver startupconfig file, default 1 time
-    uint32_t Constants::CYCLE_INTERVAL = 1;                 // Read from PVSS on driver startupconfig file, default 1 second
+    std::chrono::milliseconds Constants::CYCLE_INTERVAL = std::chrono::seconds(1);     // Read from PVSS on driver startupconfig file, default 1 second
+    uint32_t Constants::MAX_ITEMS_PER_REQUEST = 19;         // Read from PVSS on driver startupconfig file, default 19 items (snap7 accepts up to 20)
+    uint32_t Constants::PIPELINE_DEPTH = 1;                 // Read from PVSS on driver startupconfig file, default 1 request in flight per PLC
+    int32_t Constants::COALESCE_GAP = 5;                    // Read from PVSS on driver startupconfig file, default 5 bytes (the read overhead of one variable)
+    bool Constants::WRITE_CONFIRMATION = false;             // Read from PVSS on driver startupconfig file, default off (written addresses are polled again)
+    std::chrono::milliseconds Constants::METRICS_INTERVAL = std::chrono::seconds(10);  // Read from PVSS on driver startupconfig file, default 10 seconds, 0 disables
+    std::chrono::milliseconds Constants::MAX_AGE = std::chrono::milliseconds(0);       // Read from PVSS on driver startupconfig file, default 0 (smoothed values are never sent again if unchanged)
+    std::chrono::milliseconds Constants::WORKPROC_BUDGET = std::chrono::milliseconds(100);  // Read from PVSS on driver startupconfig file, default 100ms, 0 for no time limit
+    uint32_t Constants::WORKPROC_MAX_ITEMS = 0;             // Read from PVSS on driver startupconfig file, default 0 (no limit)
+    uint32_t Constants::WORKER_THREADS = 0;                 // Read from PVSS on driver startupconfig file, default 0 (one thread per PLC)
+    bool Constants::ACQUISITION_TIMESTAMPS = false;         // Read from PVSS on driver startupconfig file, default off (values are stamped by workProc)
+    std::chrono::milliseconds Constants::RECONNECT_MIN = std::chrono::seconds(1); // Read from PVSS on driver startupconfig file, default 1 second
+    std::chrono::milliseconds Constants::RECONNECT_MAX = std::chrono::seconds(60); // Read from PVSS on driver startupconfig file, default 60 seconds
+    uint32_t Constants::MAX_CONCURRENT_CONNECTS = 8;        // Read from PVSS on driver startupconfig file, default 8, 0 for no limit
+    uint32_t Constants::CIRCUIT_BREAKER_THRESHOLD = 10;     // Read from PVSS on driver startupconfig file, default 10 failed attempts, 0 disables
+    std::chrono::milliseconds Constants::CIRCUIT_BREAKER_PERIOD = std::chrono::minutes(5); // Read from PVSS on driver startupconfig file, default 5 minutes
     bool Constants::SMOOTHING = true;                       // Read from PVSS on driver startupconfig file
     std::string Constants::drv_version = PROJECT_VER;
 
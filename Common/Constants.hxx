@@ -25,6 +25,7 @@
 #include <string.h>
 #include <memory>
 #include <map>
+#include <chrono>
 #include <Common/Utils.hxx>
 #include <Common/Logger.hxx>
 
@@ -53,8 +54,8 @@ namespace Common{
         static void setRemoteTsapPort(uint32_t port);
         static const uint32_t& getRemoteTsapPort();
 
-        static void setPollingInterval(uint32_t pollingInterval);
-        static const uint32_t& getPollingInterval();
+        static void setPollingInterval(std::chrono::milliseconds pollingInterval);
+        static std::chrono::milliseconds getPollingInterval();
         
         static const std::map<std::string,std::function<void(const char *)>>& GetParseMap();
 
@@ -66,8 +67,53 @@ namespace Common{
         static uint32_t getMaxIoFailures();
         static void setMaxIoFailures(uint32_t maxIoFailures);
 
-        static uint32_t getCycleInterval();
-        static void setCycleInterval(uint32_t cycleInterval);
+        static std::chrono::milliseconds getCycleInterval();
+        static void setCycleInterval(std::chrono::milliseconds cycleInterval);
+
+        static int32_t getCoalesceGap();
+        static void setCoalesceGap(int32_t coalesceGap);
+
+        static uint32_t getMaxItemsPerRequest();
+        static void setMaxItemsPerRequest(uint32_t maxItemsPerRequest);
+
+        static uint32_t getPipelineDepth();
+        static void setPipelineDepth(uint32_t pipelineDepth);
+
+        static bool getWriteConfirmation();
+        static void setWriteConfirmation(bool writeConfirmation);
+
+        static std::chrono::milliseconds getMetricsInterval();
+        static void setMetricsInterval(std::chrono::milliseconds metricsInterval);
+
+        static std::chrono::milliseconds getMaxAge();
+        static void setMaxAge(std::chrono::milliseconds maxAge);
+
+        static std::chrono::milliseconds getWorkProcBudget();
+        static void setWorkProcBudget(std::chrono::milliseconds workProcBudget);
+
+        static uint32_t getWorkProcMaxItems();
+        static void setWorkProcMaxItems(uint32_t workProcMaxItems);
+
+        static uint32_t getWorkerThreads();
+        static void setWorkerThreads(uint32_t workerThreads);
+
+        static bool getAcquisitionTimestamps();
+        static void setAcquisitionTimestamps(bool acquisitionTimestamps);
+
+        static std::chrono::milliseconds getReconnectMin();
+        static void setReconnectMin(std::chrono::milliseconds reconnectMin);
+
+        static std::chrono::milliseconds getReconnectMax();
+        static void setReconnectMax(std::chrono::milliseconds reconnectMax);
+
+        static uint32_t getMaxConcurrentConnects();
+        static void setMaxConcurrentConnects(uint32_t maxConcurrentConnects);
+
+        static uint32_t getCircuitBreakerThreshold();
+        static void setCircuitBreakerThreshold(uint32_t circuitBreakerThreshold);
+
+        static std::chrono::milliseconds getCircuitBreakerPeriod();
+        static void setCircuitBreakerPeriod(std::chrono::milliseconds circuitBreakerPeriod);
 
     private:
         static std::string drv_name;
@@ -75,10 +121,25 @@ namespace Common{
         static uint32_t DRV_NO;   // WinCC OA manager number
         static uint32_t TSAP_PORT_LOCAL;
         static uint32_t TSAP_PORT_REMOTE;
-        static uint32_t POLLING_INTERVAL;
+        static std::chrono::milliseconds POLLING_INTERVAL;
         static bool SMOOTHING;
         static uint32_t MAX_IO_FAILURES;
-        static uint32_t CYCLE_INTERVAL;
+        static std::chrono::milliseconds CYCLE_INTERVAL;
+        static int32_t COALESCE_GAP;
+        static uint32_t MAX_ITEMS_PER_REQUEST;
+        static uint32_t PIPELINE_DEPTH;
+        static bool WRITE_CONFIRMATION;
+        static std::chrono::milliseconds METRICS_INTERVAL;
+        static std::chrono::milliseconds MAX_AGE;
+        static std::chrono::milliseconds WORKPROC_BUDGET;
+        static uint32_t WORKPROC_MAX_ITEMS;
+        static bool ACQUISITION_TIMESTAMPS;
+        static uint32_t WORKER_THREADS;
+        static std::chrono::milliseconds RECONNECT_MIN;
+        static std::chrono::milliseconds RECONNECT_MAX;
+        static uint32_t MAX_CONCURRENT_CONNECTS;
+        static uint32_t CIRCUIT_BREAKER_THRESHOLD;
+        static std::chrono::milliseconds CIRCUIT_BREAKER_PERIOD;
 
         static std::map<std::string, std::function<void(const char *)>> parse_map;
     };
@@ -126,13 +187,13 @@ namespace Common{
         return TSAP_PORT_REMOTE;
     }
 
-    inline void Constants::setPollingInterval(uint32_t pollingInterval)
+    inline void Constants::setPollingInterval(std::chrono::milliseconds pollingInterval)
     {
-        Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__,"Setting POLLING_INTERVAL=" + CharString(pollingInterval));
+        Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__,"Setting POLLING_INTERVAL=" + CharString(static_cast<long>(pollingInterval.count())) + "ms");
         POLLING_INTERVAL = pollingInterval;
     }
 
-    inline const uint32_t& Constants::getPollingInterval()
+    inline std::chrono::milliseconds Constants::getPollingInterval()
     {
         return POLLING_INTERVAL;
     }
@@ -153,13 +214,149 @@ namespace Common{
         MAX_IO_FAILURES = maxIoFailures;
     }
 
-    inline uint32_t Constants::getCycleInterval() {
+    inline std::chrono::milliseconds Constants::getCycleInterval() {
         return CYCLE_INTERVAL;
     }
 
-    inline void Constants::setCycleInterval(uint32_t cycleInterval) {
+    inline void Constants::setCycleInterval(std::chrono::milliseconds cycleInterval) {
+        Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__,"Setting CYCLE_INTERVAL=" + CharString(static_cast<long>(cycleInterval.count())) + "ms");
         CYCLE_INTERVAL = cycleInterval;
     }
 
+    inline int32_t Constants::getCoalesceGap() {
+        return COALESCE_GAP;
+    }
+
+    inline void Constants::setCoalesceGap(int32_t coalesceGap) {
+        Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__,"Setting COALESCE_GAP=" + CharString(coalesceGap));
+        COALESCE_GAP = coalesceGap;
+    }
+
+    inline uint32_t Constants::getMaxItemsPerRequest() {
+        return MAX_ITEMS_PER_REQUEST;
+    }
+
+    inline void Constants::setMaxItemsPerRequest(uint32_t maxItemsPerRequest) {
+        Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__,"Setting MAX_ITEMS_PER_REQUEST=" + CharString(maxItemsPerRequest));
+        MAX_ITEMS_PER_REQUEST = maxItemsPerRequest;
+    }
+
+    inline uint32_t Constants::getPipelineDepth() {
+        return PIPELINE_DEPTH;
+    }
+
+    inline void Constants::setPipelineDepth(uint32_t pipelineDepth) {
+        Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__,"Setting PIPELINE_DEPTH=" + CharString(pipelineDepth));
+        PIPELINE_DEPTH = pipelineDepth;
+    }
+
+    inline bool Constants::getWriteConfirmation() {
+        return WRITE_CONFIRMATION;
+    }
+
+    inline void Constants::setWriteConfirmation(bool writeConfirmation) {
+        Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__,"Setting WRITE_CONFIRMATION=" + CharString(writeConfirmation ? 1 : 0));
+        WRITE_CONFIRMATION = writeConfirmation;
+    }
+
+    inline std::chrono::milliseconds Constants::getMetricsInterval() {
+        return METRICS_INTERVAL;
+    }
+
+    inline void Constants::setMetricsInterval(std::chrono::milliseconds metricsInterval) {
+        Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__,"Setting METRICS_INTERVAL=" + CharString(static_cast<long>(metricsInterval.count())) + "ms");
+        METRICS_INTERVAL = metricsInterval;
+    }
+
+    inline std::chrono::milliseconds Constants::getMaxAge() {
+        return MAX_AGE;
+    }
+
+    inline void Constants::setMaxAge(std::chrono::milliseconds maxAge) {
+        Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__,"Setting MAX_AGE=" + CharString(static_cast<long>(maxAge.count())) + "ms");
+        MAX_AGE = maxAge;
+    }
+
+    inline std::chrono::milliseconds Constants::getWorkProcBudget() {
+        return WORKPROC_BUDGET;
+    }
+
+    inline void Constants::setWorkProcBudget(std::chrono::milliseconds workProcBudget) {
+        Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__,"Setting WORKPROC_BUDGET=" + CharString(static_cast<long>(workProcBudget.count())) + "ms");
+        WORKPROC_BUDGET = workProcBudget;
+    }
+
+    inline uint32_t Constants::getWorkProcMaxItems() {
+        return WORKPROC_MAX_ITEMS;
+    }
+
+    inline void Constants::setWorkProcMaxItems(uint32_t workProcMaxItems) {
+        Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__,"Setting WORKPROC_MAX_ITEMS=" + CharString(workProcMaxItems));
+        WORKPROC_MAX_ITEMS = workProcMaxItems;
+    }
+
+    inline uint32_t Constants::getWorkerThreads() {
+        return WORKER_THREADS;
+    }
+
+    inline void Constants::setWorkerThreads(uint32_t workerThreads) {
+        Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__,"Setting WORKER_THREADS=" + CharString(workerThreads));
+        WORKER_THREADS = workerThreads;
+    }
+
+    inline bool Constants::getAcquisitionTimestamps() {
+        return ACQUISITION_TIMESTAMPS;
+    }
+
+    inline void Constants::setAcquisitionTimestamps(bool acquisitionTimestamps) {
+        Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__,"Setting ACQUISITION_TIMESTAMPS=" + CharString(acquisitionTimestamps ? 1 : 0));
+        ACQUISITION_TIMESTAMPS = acquisitionTimestamps;
+    }
+
+    inline std::chrono::milliseconds Constants::getReconnectMin() {
+        return RECONNECT_MIN;
+    }
+
+    inline void Constants::setReconnectMin(std::chrono::milliseconds reconnectMin) {
+        Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__,"Setting RECONNECT_MIN=" + CharString(static_cast<long>(reconnectMin.count())) + "ms");
+        RECONNECT_MIN = reconnectMin;
+    }
+
+    inline std::chrono::milliseconds Constants::getReconnectMax() {
+        return RECONNECT_MAX;
+    }
+
+    inline void Constants::setReconnectMax(std::chrono::milliseconds reconnectMax) {
+        Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__,"Setting RECONNECT_MAX=" + CharString(static_cast<long>(reconnectMax.count())) + "ms");
+        RECONNECT_MAX = reconnectMax;
+    }
+
+    inline uint32_t Constants::getMaxConcurrentConnects() {
+        return MAX_CONCURRENT_CONNECTS;
+    }
+
+    inline void Constants::setMaxConcurrentConnects(uint32_t maxConcurrentConnects) {
+        Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__,"Setting MAX_CONCURRENT_CONNECTS=" + CharString(maxConcurrentConnects));
+        MAX_CONCURRENT_CONNECTS = maxConcurrentConnects;
+    }
+
+    inline uint32_t Constants::getCircuitBreakerThreshold() {
+        return CIRCUIT_BREAKER_THRESHOLD;
+    }
+
+    inline void Constants::setCircuitBreakerThreshold(uint32_t circuitBreakerThreshold) {
+        Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__,"Setting CIRCUIT_BREAKER_THRESHOLD=" + CharString(circuitBreakerThreshold));
+        CIRCUIT_BREAKER_THRESHOLD = circuitBreakerThreshold;
+    }
+
+    inline std::chrono::milliseconds Constants::getCircuitBreakerPeriod() {
+        return CIRCUIT_BREAKER_PERIOD;
+    }
+
+    inline void Constants::setCircuitBreakerPeriod(std::chrono::milliseconds circuitBreakerPeriod) {
+        Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__,"Setting CIRCUIT_BREAKER_PERIOD=" + CharString(static_cast<long>(circuitBreakerPeriod.count())) + "ms");
+        CIRCUIT_BREAKER_PERIOD = circuitBreakerPeriod;
+    }
+
 }//namespace
 #endif /* CONSTANTS_HXX_ */
@@ -0,0 +1,98 @@
+/** © Copyright 2024 CERN
+ *
+ * This software is distributed under the terms of the
+ * GNU Lesser General Public Licence version 3 (LGPL Version 3),
+ * copied verbatim in the file “LICENSE”
+ *
+ * In applying this licence, CERN does not waive the privileges
+ * and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * Author: Alexandru Savulescu (HSE)
+ *
+ **/
+
+#include "Metrics.hxx"
+#include <algorithm>
+#include <sstream>
+
+namespace Common {
+
+    std::mutex Metrics::_mutex;
+    std::map<std::string, Metrics::Counter> Metrics::_counters;
+    std::map<std::string, int64_t> Metrics::_gauges;
+    std::map<std::string, Metrics::Histogram> Metrics::_latencies;
+
+    Metrics::Counter& Metrics::counter(const std::string& name)
+    {
+        std::lock_guard lock{_mutex};
+        return _counters[name];
+    }
+
+    Metrics::Histogram& Metrics::histogram(const std::string& name)
+    {
+        std::lock_guard lock{_mutex};
+        return _latencies[name];
+    }
+
+    void Metrics::set(const std::string& name, int64_t value)
+    {
+        std::lock_guard lock{_mutex};
+        _gauges[name] = value;
+    }
+
+    void Metrics::Histogram::record(std::chrono::microseconds latency)
+    {
+        const int64_t us = latency.count();
+        _count.fetch_add(1, std::memory_order_relaxed);
+        _lastUs.store(us, std::memory_order_relaxed);
+        _sumUs.fetch_add(us, std::memory_order_relaxed);
+        int64_t max = _maxUs.load(std::memory_order_relaxed);
+        while(us > max && !_maxUs.compare_exchange_weak(max, us, std::memory_order_relaxed));
+        size_t bucket = 0;
+        while(bucket < LATENCY_BUCKETS - 1 && (int64_t{1} << bucket) <= us) {
+            ++bucket;
+        }
+        _buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    int64_t Metrics::Histogram::percentileUs(double fraction, uint64_t count, int64_t maxUs) const
+    {
+        const auto rank = static_cast<uint64_t>(fraction * count + 0.5);
+        uint64_t seen = 0;
+        for(size_t bucket = 0; bucket < LATENCY_BUCKETS - 1; ++bucket) {
+            seen += _buckets[bucket].load(std::memory_order_relaxed);
+            if(seen >= rank) {
+                return std::min(int64_t{1} << bucket, maxUs);
+            }
+        }
+        return maxUs;
+    }
+
+    std::string Metrics::Histogram::toString() const
+    {
+        const auto count = _count.load(std::memory_order_relaxed);
+        const auto sumUs = _sumUs.load(std::memory_order_relaxed);
+        const auto maxUs = _maxUs.load(std::memory_order_relaxed);
+        std::stringstream ss;
+        ss << "count=" << count << " last=" << _lastUs.load(std::memory_order_relaxed) << "us mean=" << (count ? sumUs / static_cast<int64_t>(count) : 0)
+           << "us p50=" << percentileUs(0.5, count, maxUs) << "us p99=" << percentileUs(0.99, count, maxUs) << "us max=" << maxUs << "us";
+        return ss.str();
+    }
+
+    std::string Metrics::toString()
+    {
+        std::lock_guard lock{_mutex};
+        std::stringstream ss;
+        for(const auto& [name, value] : _counters) {
+            ss << name << "=" << value.value() << "\n";
+        }
+        for(const auto& [name, value] : _gauges) {
+            ss << name << "=" << value << "\n";
+        }
+        for(const auto& [name, stat] : _latencies) {
+            ss << name << "=" << stat.toString() << "\n";
+        }
+        return ss.str();
+    }
+}
@@ -0,0 +1,94 @@
+/** © Copyright 2024 CERN
+ *
+ * This software is distributed under the terms of the
+ * GNU Lesser General Public Licence version 3 (LGPL Version 3),
+ * copied verbatim in the file “LICENSE”
+ *
+ * In applying this licence, CERN does not waive the privileges
+ * and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * Author: Alexandru Savulescu (HSE)
+ *
+ **/
+
+#pragma once
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <array>
+#include <atomic>
+
+namespace Common {
+
+/*!
+ * \class Metrics
+ * \brief Driver wide registry of named counters, gauges and latencies.
+ * Can be updated from any thread, and is published as text on the _METRICS address (see Constants::getMetricsInterval).
+ * Per PLC metrics are named "<ip>.<metric>".
+ *
+ * Hot paths resolve a Counter or Histogram handle once with counter() / histogram() and update it lock-free;
+ * the registry lock is only taken to resolve a handle, to set a gauge and to publish (toString).
+ */
+class Metrics{
+public:
+    // Latency histogram: bucket i counts the samples below 2^i us, the last one everything above
+    static constexpr size_t LATENCY_BUCKETS = 28;
+
+    class Counter
+    {
+    public:
+        void add(uint64_t n = 1) { _value.fetch_add(n, std::memory_order_relaxed); }
+        uint64_t value() const { return _value.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<uint64_t> _value{0};
+    };
+
+    class Histogram
+    {
+    public:
+        // Records one sample, with relaxed atomics: a concurrent toString may see a sample partly counted
+        void record(std::chrono::microseconds latency);
+        // "count=... last=...us mean=...us p50=...us p99=...us max=...us"
+        std::string toString() const;
+
+    private:
+        // Upper bound of the bucket holding the given fraction of the samples
+        int64_t percentileUs(double fraction, uint64_t count, int64_t maxUs) const;
+
+        std::atomic<uint64_t> _count{0};
+        std::atomic<int64_t> _lastUs{0};
+        std::atomic<int64_t> _sumUs{0};
+        std::atomic<int64_t> _maxUs{0};
+        std::array<std::atomic<uint64_t>, LATENCY_BUCKETS> _buckets{};
+    };
+
+    // Handles stay valid for the lifetime of the driver
+    static Counter& counter(const std::string& name);
+    static Histogram& histogram(const std::string& name);
+
+    // Adds n to a counter (resolves the counter, prefer a handle on hot paths)
+    static void increment(const std::string& name, uint64_t n = 1) { counter(name).add(n); }
+
+    // Sets a gauge to its current value
+    static void set(const std::string& name, int64_t value);
+
+    // Records one sample of a latency (resolves the histogram, prefer a handle on hot paths)
+    static void record(const std::string& name, std::chrono::microseconds latency) { histogram(name).record(latency); }
+
+    // One "name=value" line per metric
+    static std::string toString();
+
+private:
+    static std::mutex _mutex;
+    // std::map nodes never move, so that handles can be kept
+    static std::map<std::string, Counter> _counters;
+    static std::map<std::string, int64_t> _gauges;
+    static std::map<std::string, Histogram> _latencies;
+};
+
+}//namespace
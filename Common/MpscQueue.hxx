@@ -0,0 +1,113 @@
+/** © Copyright 2024 CERN
+ *
+ * This software is distributed under the terms of the
+ * GNU Lesser General Public Licence version 3 (LGPL Version 3),
+ * copied verbatim in the file “LICENSE”
+ *
+ * In applying this licence, CERN does not waive the privileges
+ * and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * Author: Alexandru Savulescu (HSE)
+ *
+ **/
+#pragma once
+
+#include <atomic>
+#include <utility>
+#include <cstdint>
+
+namespace Common{
+
+    /*!
+    * \class MpscQueue
+    * \brief Unbounded lock-free multi-producer / single-consumer queue (Vyukov's node based queue).
+    *
+    * push() never blocks nor spins: a single atomic exchange links the new node. pop() must only be called from one thread.
+    * A pop() racing with a push() whose node is not linked yet returns false; the value is then available on the next pop().
+    * Meant for coarse elements (e.g. a batch of values per poll cycle), as each push allocates one node.
+    */
+    template <typename T>
+    class MpscQueue{
+        private:
+            struct Node
+            {
+                std::atomic<Node*> next{nullptr};
+                T value;
+            };
+
+        public:
+            MpscQueue() : _head(&_stub), _tail(&_stub) {}
+
+            ~MpscQueue()
+            {
+                T value;
+                while(pop(value));
+            }
+
+            MpscQueue(const MpscQueue&) = delete;
+            MpscQueue& operator=(const MpscQueue&) = delete;
+
+            void push(T&& value)
+            {
+                auto node = new Node;
+                node->value = std::move(value);
+                link(node);
+            }
+
+            // Single consumer only
+            bool pop(T& value)
+            {
+                Node* tail = _tail;
+                Node* next = tail->next.load(std::memory_order_acquire);
+                if(tail == &_stub) {
+                    if(next == nullptr) {
+                        return false;
+                    }
+                    _tail = next;
+                    tail = next;
+                    next = next->next.load(std::memory_order_acquire);
+                }
+                if(next != nullptr) {
+                    _tail = next;
+                    return take(tail, value);
+                }
+                if(tail != _head.load(std::memory_order_acquire)) {
+                    // A producer swapped the head but did not link its node yet
+                    _racedPops.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                // tail is the last node: put the stub behind it so that it can be taken
+                link(&_stub);
+                next = tail->next.load(std::memory_order_acquire);
+                if(next != nullptr) {
+                    _tail = next;
+                    return take(tail, value);
+                }
+                return false;
+            }
+
+            // Number of pops that found a node being linked by a producer
+            uint64_t racedPops() const { return _racedPops.load(std::memory_order_relaxed); }
+
+        private:
+            void link(Node* node)
+            {
+                node->next.store(nullptr, std::memory_order_relaxed);
+                Node* previous = _head.exchange(node, std::memory_order_acq_rel);
+                previous->next.store(node, std::memory_order_release);
+            }
+
+            static bool take(Node* node, T& value)
+            {
+                value = std::move(node->value);
+                delete node;
+                return true;
+            }
+
+            Node _stub;
+            std::atomic<Node*> _head;   // last pushed node, producers side
+            Node* _tail;                // next node to pop, consumer side
+            std::atomic<uint64_t> _racedPops{0};
+    }; //class MpscQueue
+} //namespace Common
@@ -0,0 +1,158 @@
+/** © Copyright 2024 CERN
+ *
+ * This software is distributed under the terms of the
+ * GNU Lesser General Public Licence version 3 (LGPL Version 3),
+ * copied verbatim in the file “LICENSE”
+ *
+ * In applying this licence, CERN does not waive the privileges
+ * and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * Author: Alexandru Savulescu (HSE)
+ *
+ **/
+#pragma once
+
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include "snap7.h"
+
+namespace Common{
+
+    /*!
+    * \class S7Address
+    * \brief Decoded S7 address (e.g. VB2978.20, VW100, V255.3), packed in 64 bits.
+    *
+    * Parse() reads the address in a single pass, without allocating nor throwing, and can be evaluated at compile time.
+    * The packed value is 0 for an invalid address, and otherwise identifies the location uniquely: it can be used as a hash key.
+    * Layout: area (8 bits) | word length (8 bits) | unused (5 bits) | bit (3 bits) | amount (16 bits) | start byte (24 bits)
+    */
+    class S7Address{
+        public:
+            static constexpr uint64_t MAX_START = (uint64_t{1} << 24) - 1;
+            static constexpr uint64_t MAX_AMOUNT = (uint64_t{1} << 16) - 1;
+
+            constexpr S7Address() = default;
+
+            /**
+             * @brief Parses an address: area letter, then B, W or D and a byte offset (VB12, VW12, VD12),
+             * with an amount of bytes for B (VB12.20), or a byte offset and a bit for bits (V12.3)
+             * @return an invalid address (valid() is false) if the address cannot be parsed
+             */
+            static constexpr S7Address Parse(std::string_view address) noexcept
+            {
+                if(address.size() < 2) {
+                    return S7Address();
+                }
+                const int area = AreaOf(address[0]);
+                if(area < 0) {
+                    return S7Address();
+                }
+                int wordLen = S7WLBit;
+                size_t pos = 1;
+                switch(Upper(address[1])) {
+                    case 'B': wordLen = S7WLByte; pos = 2; break;
+                    case 'W': wordLen = S7WLWord; pos = 2; break;
+                    case 'D': wordLen = S7WLReal; pos = 2; break;   //e.g. VD124 GLB.CAL.GANA1
+                    default: break;                                 //e.g.: V255.3
+                }
+                uint64_t start = 0;
+                if(!ParseNumber(address, pos, MAX_START, start)) {
+                    return S7Address();
+                }
+                uint64_t amount = 1;
+                uint64_t bit = 0;
+                if(pos == address.size()) {
+                    // A bit address needs its bit
+                    return wordLen == S7WLBit ? S7Address() : S7Address(area, wordLen, start, amount, bit);
+                }
+                if(address[pos] != '.' || (wordLen != S7WLByte && wordLen != S7WLBit)) {
+                    return S7Address();
+                }
+                ++pos;
+                uint64_t suffix = 0;
+                if(!ParseNumber(address, pos, MAX_AMOUNT, suffix) || pos != address.size()) {
+                    return S7Address();
+                }
+                if(wordLen == S7WLByte) {
+                    if(suffix == 0) {
+                        return S7Address();
+                    }
+                    amount = suffix;
+                } else {
+                    if(suffix > 7) {
+                        return S7Address();
+                    }
+                    bit = suffix;
+                }
+                return S7Address(area, wordLen, start, amount, bit);
+            }
+
+            constexpr bool valid() const { return _packed != 0; }
+            constexpr uint64_t packed() const { return _packed; }
+
+            constexpr int area() const { return static_cast<int>(_packed >> 56); }
+            constexpr int wordLen() const { return static_cast<int>((_packed >> 48) & 0xFF); }
+            // Byte offset of the address
+            constexpr int start() const { return static_cast<int>(_packed & MAX_START); }
+            constexpr int amount() const { return static_cast<int>((_packed >> 24) & MAX_AMOUNT); }
+            constexpr int bit() const { return static_cast<int>((_packed >> 40) & 0x7); }
+            // Start as given to snap7: in bits for a bit address
+            constexpr int s7Start() const { return wordLen() == S7WLBit ? start() * 8 + bit() : start(); }
+
+            constexpr bool operator==(const S7Address& other) const { return _packed == other._packed; }
+            constexpr bool operator!=(const S7Address& other) const { return _packed != other._packed; }
+
+            struct Hash
+            {
+                size_t operator()(const S7Address& address) const { return static_cast<size_t>(address._packed * 0x9E3779B97F4A7C15ULL >> 16); }
+            };
+
+        private:
+            constexpr S7Address(int area, int wordLen, uint64_t start, uint64_t amount, uint64_t bit)
+                : _packed((static_cast<uint64_t>(area) << 56) | (static_cast<uint64_t>(wordLen) << 48) | (bit << 40) | (amount << 24) | start)
+            {
+            }
+
+            static constexpr char Upper(char c)
+            {
+                return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+            }
+
+            static constexpr int AreaOf(char c)
+            {
+                switch(Upper(c)) {
+                    case 'V': return S7AreaDB;          //Data Blocks
+                    case 'I': case 'E': return S7AreaPE; //Inputs
+                    case 'Q': case 'A': return S7AreaPA; //Outputs
+                    case 'M': case 'F': return S7AreaMK; //Flag memory
+                    case 'T': return S7AreaTM;          //Timers
+                    case 'C': case 'Z': return S7AreaCT; //Counters
+                    default: return -1;
+                }
+            }
+
+            // Reads at least one digit from pos, failing above max
+            static constexpr bool ParseNumber(std::string_view str, size_t& pos, uint64_t max, uint64_t& value)
+            {
+                const size_t first = pos;
+                value = 0;
+                while(pos < str.size() && str[pos] >= '0' && str[pos] <= '9') {
+                    value = value * 10 + static_cast<uint64_t>(str[pos] - '0');
+                    if(value > max) {
+                        return false;
+                    }
+                    ++pos;
+                }
+                return pos > first;
+            }
+
+            uint64_t _packed{0};
+    }; //class S7Address
+
+    static_assert(S7Address::Parse("VB2978.20").amount() == 20 && S7Address::Parse("VB2978.20").start() == 2978, "S7Address: byte range");
+    static_assert(S7Address::Parse("V255.3").s7Start() == 255 * 8 + 3 && S7Address::Parse("V255.3").wordLen() == S7WLBit, "S7Address: bit");
+    static_assert(S7Address::Parse("qw10").area() == S7AreaPA && S7Address::Parse("qw10").wordLen() == S7WLWord, "S7Address: case");
+    static_assert(!S7Address::Parse("V255").valid() && !S7Address::Parse("VW10.2").valid() && !S7Address::Parse("VB10x").valid(), "S7Address: invalid");
+} //namespace Common
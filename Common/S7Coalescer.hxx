@@ -0,0 +1,248 @@
+/** © Copyright 2024 CERN
+ *
+ * This software is distributed under the terms of the
+ * GNU Lesser General Public Licence version 3 (LGPL Version 3),
+ * copied verbatim in the file “LICENSE”
+ *
+ * In applying this licence, CERN does not waive the privileges
+ * and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * Author: Alexandru Savulescu (HSE)
+ *
+ **/
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+#include <cstring>
+#include "snap7.h"
+#include "Common/S7Utils.hxx"
+
+namespace Common{
+
+    /*!
+    * \class S7Coalescer
+    * \brief Merges S7 data items living in the same area into contiguous byte ranges,
+    * so that N neighbouring variables cost a single multi-var slot instead of N.
+    */
+    class S7Coalescer{
+        public:
+            struct Batch
+            {
+                size_t first;   // index of the first item of the batch
+                size_t count;   // number of consecutive items sent in one request
+                size_t bytes;   // PDU size used by the batch, message overhead included
+                bool split;     // single item bigger than a PDU, to be sent with Read/WriteArea which splits it
+            };
+
+            // Only byte addressable areas can be merged. Bits, timers and counters keep their own item.
+            static bool IsCoalescable(const TS7DataItem& item)
+            {
+                switch(item.Area){
+                    case S7AreaDB:
+                    case S7AreaPE:
+                    case S7AreaPA:
+                    case S7AreaMK:
+                        return item.WordLen != S7WLBit && item.WordLen != S7WLTimer && item.WordLen != S7WLCounter;
+                    default:
+                        return false;
+                }
+            }
+
+            // A bit of a byte addressable area, that can be read through its containing byte
+            static bool IsPackableBit(const TS7DataItem& item)
+            {
+                TS7DataItem byteItem = item;
+                byteItem.WordLen = S7WLByte;
+                return item.WordLen == S7WLBit && item.Amount == 1 && IsCoalescable(byteItem);
+            }
+
+            // The byte holding a bit item (whose Start is byte * 8 + bit)
+            static TS7DataItem ContainingByte(const TS7DataItem& bitItem)
+            {
+                TS7DataItem byteItem = bitItem;
+                byteItem.WordLen = S7WLByte;
+                byteItem.Start = bitItem.Start / 8;
+                byteItem.Amount = 1;
+                return byteItem;
+            }
+
+            static char ExtractBit(char byte, int bit)
+            {
+                return static_cast<char>((static_cast<unsigned char>(byte) >> bit) & 1);
+            }
+
+            static size_t ByteSize(const TS7DataItem& item)
+            {
+                return S7Utils::DataSizeByte(item.WordLen) * static_cast<size_t>(item.Amount);
+            }
+
+            /**
+             * @brief Groups the items into ranges
+             * @param items : the items to read
+             * @param members : filled with, for each range, the indexes (in items) of the items it covers
+             * @param maxGap : max number of unused bytes allowed between two merged items, negative disables merging
+             * @param maxRangeSize : max size in bytes of a merged range (so that it still fits in a single PDU)
+             * @return the range items to read (S7WLByte unless holding a single non coalescable item), without any buffer allocated
+             */
+            static std::vector<TS7DataItem> Coalesce(const std::vector<TS7DataItem>& items, std::vector<std::vector<size_t>>& members, int maxGap, size_t maxRangeSize)
+            {
+                std::vector<size_t> order(items.size());
+                std::iota(order.begin(), order.end(), 0);
+                std::sort(order.begin(), order.end(), [&items](size_t a, size_t b){
+                    const auto& ia = items[a];
+                    const auto& ib = items[b];
+                    return std::tie(ia.Area, ia.DBNumber, ia.Start) < std::tie(ib.Area, ib.DBNumber, ib.Start);
+                });
+
+                std::vector<TS7DataItem> ranges;
+                ranges.reserve(items.size());
+                members.clear();
+                members.reserve(items.size());
+                size_t rangeEnd = 0;
+
+                for(const auto idx : order) {
+                    const auto& item = items[idx];
+                    const size_t start = static_cast<size_t>(item.Start);
+                    const size_t end = start + ByteSize(item);
+
+                    if(maxGap < 0 || !IsCoalescable(item)) {
+                        ranges.emplace_back(item);
+                        members.push_back({idx});
+                        continue;
+                    }
+
+                    if(!ranges.empty()) {
+                        auto& last = ranges.back();
+                        const bool sameBlock = IsCoalescable(last) && last.Area == item.Area && last.DBNumber == item.DBNumber;
+                        const size_t lastStart = static_cast<size_t>(last.Start);
+                        // Merging pays the gap bytes instead of one variable header, and must keep the range packable in one PDU
+                        if(sameBlock && start <= rangeEnd + static_cast<size_t>(maxGap) && std::max(rangeEnd, end) - lastStart <= maxRangeSize) {
+                            rangeEnd = std::max(rangeEnd, end);
+                            last.Amount = static_cast<int>(rangeEnd - lastStart);
+                            members.back().push_back(idx);
+                            continue;
+                        }
+                    }
+
+                    TS7DataItem rangeItem = item;
+                    rangeItem.WordLen = S7WLByte;
+                    rangeItem.Amount = static_cast<int>(end - start);
+                    ranges.emplace_back(rangeItem);
+                    members.push_back({idx});
+                    rangeEnd = end;
+                }
+
+                for(auto& range : ranges) {
+                    range.pdata = nullptr;
+                    range.Result = -1;
+                }
+                return ranges;
+            }
+
+            /**
+             * @brief Merges items to write whose bytes are exactly contiguous (no gap, no overlap) in the same area,
+             * so that no byte outside of the written items is ever touched
+             * @param items : the items to write, with their data
+             * @param members : filled with, for each range, the indexes (in items) of the items it covers
+             * @param maxRangeSize : max size in bytes of a merged range
+             * @return the range items to write. A range covering a single item shares its buffer,
+             * a merged range owns a new buffer holding the data of all its items (see FreeWriteRanges)
+             */
+            static std::vector<TS7DataItem> CoalesceWrites(const std::vector<TS7DataItem>& items, std::vector<std::vector<size_t>>& members, size_t maxRangeSize)
+            {
+                std::vector<size_t> order(items.size());
+                std::iota(order.begin(), order.end(), 0);
+                std::sort(order.begin(), order.end(), [&items](size_t a, size_t b){
+                    const auto& ia = items[a];
+                    const auto& ib = items[b];
+                    return std::tie(ia.Area, ia.DBNumber, ia.Start) < std::tie(ib.Area, ib.DBNumber, ib.Start);
+                });
+
+                std::vector<TS7DataItem> ranges;
+                ranges.reserve(items.size());
+                members.clear();
+                members.reserve(items.size());
+
+                for(const auto idx : order) {
+                    const auto& item = items[idx];
+                    if(!ranges.empty() && IsCoalescable(item)) {
+                        auto& last = ranges.back();
+                        const auto& lastItem = items[members.back().back()];
+                        const bool contiguous = IsCoalescable(lastItem) && lastItem.Area == item.Area && lastItem.DBNumber == item.DBNumber &&
+                            static_cast<size_t>(item.Start) == static_cast<size_t>(last.Start) + ByteSize(last);
+                        const auto size = ByteSize(last) + ByteSize(item);
+                        if(contiguous && size <= maxRangeSize) {
+                            last.WordLen = S7WLByte;
+                            last.Amount = static_cast<int>(size);
+                            members.back().push_back(idx);
+                            continue;
+                        }
+                    }
+                    ranges.emplace_back(item);
+                    members.push_back({idx});
+                }
+
+                for(size_t r = 0; r < ranges.size(); ++r) {
+                    if(members[r].size() < 2) {
+                        continue;
+                    }
+                    auto& range = ranges[r];
+                    auto data = new char[ByteSize(range)];
+                    for(const auto idx : members[r]) {
+                        std::memcpy(data + (items[idx].Start - range.Start), items[idx].pdata, ByteSize(items[idx]));
+                    }
+                    range.pdata = data;
+                }
+                return ranges;
+            }
+
+            // Frees the buffers owned by the merged ranges returned by CoalesceWrites
+            static void FreeWriteRanges(std::vector<TS7DataItem>& ranges, const std::vector<std::vector<size_t>>& members)
+            {
+                for(size_t r = 0; r < ranges.size(); ++r) {
+                    if(members[r].size() > 1) {
+                        S7Utils::TS7DeallocateDataItem(ranges[r]);
+                    }
+                }
+            }
+
+            /**
+             * @brief Splits the items in batches of consecutive items that fit in a single multi-var request
+             * @param items : the items to send
+             * @param maxItems : max number of items in one request
+             * @param pduSize : negotiated PDU size
+             * @param varOverhead : overhead in bytes of each item
+             * @param msgOverhead : overhead in bytes of the message
+             */
+            static std::vector<Batch> Pack(const std::vector<TS7DataItem>& items, size_t maxItems, size_t pduSize, size_t varOverhead, size_t msgOverhead)
+            {
+                std::vector<Batch> batches;
+                size_t first = 0;
+                while(first < items.size()) {
+                    size_t count = 0;
+                    size_t sum = 0;
+                    for(auto i = first; i < items.size() && count < maxItems; ++i) {
+                        const auto itemSize = ByteSize(items[i]) + varOverhead;
+                        if(sum + itemSize >= pduSize - msgOverhead) {
+                            break;
+                        }
+                        sum += itemSize;
+                        ++count;
+                    }
+
+                    if(count == 0) {
+                        batches.emplace_back(Batch{first, 1, ByteSize(items[first]) + varOverhead + msgOverhead, true});
+                        ++first;
+                    } else {
+                        batches.emplace_back(Batch{first, count, sum + msgOverhead, false});
+                        first += count;
+                    }
+                }
+                return batches;
+            }
+    }; //class S7Coalescer
+} //namespace Common
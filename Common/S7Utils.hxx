@@ -19,116 +19,42 @@
 #include <sstream>
 #include <iomanip>
 #include "Common/Utils.hxx"
+#include "Common/S7Address.hxx"
 
 namespace Common{
     class S7Utils{
         public:
             enum class Operation: int {READ = 0, WRITE = 1};
+            // The AddressGet* helpers return -1 if the address is invalid, see S7Address::Parse
             static int AddressGetArea(const std::string& Address)
             {
-                if(Address.length() < 2){
-                    return -1; //invalid
-                }
-                switch(std::toupper(Address[0]))
-                {
-                    case 'V': //Data Blocks
-                        return S7AreaDB;
-                    case 'I':
-                    case 'E': //Inputs
-                        return S7AreaPE;
-                    case 'Q':
-                    case 'A': //Outputs
-                        return S7AreaPA;
-                    case 'M':
-                    case 'F': //Flag memory
-                        return S7AreaMK;
-                    case 'T': //Timers
-                        return S7AreaTM;
-                    case 'C':
-                    case 'Z': //Counters
-                        return S7AreaCT;
-                    default:
-                        return -1; //invalid
-                }
-
-                return 0; //dummy
+                const auto address = S7Address::Parse(Address);
+                return address.valid() ? address.area() : -1;
             }
 
             static int AddressGetWordLen(const std::string& Address)
             {
-                if(Address.length() < 2){
-                    return -1; //invalid
-                }
-                switch(std::toupper(Address[1]))
-                {
-                    case 'B':
-                        return S7WLByte;
-                    case 'W':
-                        return S7WLWord;
-                    case 'D':
-                        return S7WLReal;     //e.g. VD124 GLB.CAL.GANA1
-                    default:                
-                        return S7WLBit;      //e.g.: V255.3
-                }
-                return 0; //dummy
+                const auto address = S7Address::Parse(Address);
+                return address.valid() ? address.wordLen() : -1;
             }
 
-
+            // Byte offset of the address
             static int AddressGetStart(const std::string& Address)
             {
-                if(Address.length() < 2){
-                    return -1; //invalid
-                }
-                switch(std::toupper(Address[1]))
-                {
-                    case 'B':
-                    case 'W':
-                    case 'D':  
-                        //Addesses like XX9999
-                        if(Address.find_first_of('.')  == std::string::npos){
-                            return std::stoi(Address.substr(2)); //e.g.:VB2978
-                        }
-                        else{
-                            return std::stoi(Address.substr(2, Address.find_first_of('.')-1)); //e.g.:VB2978.20
-                        }
-                        break;
-                    default:
-                        //Addesses like X9999
-                        if(Address.find_first_of('.')  == std::string::npos){
-                            return -1; //invalid
-                        }
-                        else{
-                            return std::stoi(Address.substr(1, Address.find_first_of('.')-1)); //e.g.: V255.3
-                        }
-                        break;
-                }
-                
-                return 0; //dummy
+                const auto address = S7Address::Parse(Address);
+                return address.valid() ? address.start() : -1;
             }
 
-
-
             static int AddressGetAmount(const std::string& Address)
             {
-                if(Address.length() < 2){
-                    return -1; //invalid
-                }
-                if(std::toupper(Address[1]) == 'B' && Address.find_first_of('.') != std::string::npos){
-                    return std::stoi(Address.substr(Address.find('.')+1));
-                }
-                return 1; //default
+                const auto address = S7Address::Parse(Address);
+                return address.valid() ? address.amount() : -1;
             }
 
             static int AddressGetBit(const std::string& Address)
             {
-                if(Address.length() < 2){
-                    return -1; //invalid
-                }
-                if(AddressGetWordLen(Address) == S7WLBit && Address.find_first_of('.') != std::string::npos){
-                    return std::stoi(Address.substr(Address.find('.')+1));
-                }
-
-                return 0; //default
+                const auto address = S7Address::Parse(Address);
+                return address.valid() ? address.bit() : -1;
             }
 
             static size_t DataSizeByte(int WordLength)
@@ -146,10 +72,7 @@ namespace Common{
             }
 
             static bool AddressIsValid(const std::string& Address){
-                return AddressGetArea(Address)!=-1 && 
-                AddressGetWordLen(Address)!=-1 &&
-                AddressGetAmount(Address)!=-1 &&
-                AddressGetStart(Address)!=-1;
+                return S7Address::Parse(Address).valid();
             }
 
             static std::string DisplayTS7DataItem(const PS7DataItem& item, Operation op = Operation::READ)
@@ -201,12 +124,17 @@ namespace Common{
             }
 
             static TS7DataItem TS7DataItemFromAddress(const std::string& Address, bool allocateMemory = false){
+                return TS7DataItemFromAddress(S7Address::Parse(Address), allocateMemory);
+            }
+
+            // All fields are -1 for an invalid address
+            static TS7DataItem TS7DataItemFromAddress(const S7Address& address, bool allocateMemory = false){
                 TS7DataItem item;
-                item.Area     = AddressGetArea(Address);
-                item.WordLen  = AddressGetWordLen(Address);
+                item.Area     = address.valid() ? address.area() : -1;
+                item.WordLen  = address.valid() ? address.wordLen() : -1;
                 item.DBNumber = 1;
-                item.Start    = item.WordLen == S7WLBit ? (AddressGetStart(Address)*8)+AddressGetBit(Address) : AddressGetStart(Address);
-                item.Amount   = AddressGetAmount(Address);
+                item.Start    = address.valid() ? address.s7Start() : -1;
+                item.Amount   = address.valid() ? address.amount() : -1;
                 item.Result   = -1;
                 item.pdata    = nullptr;
                 if(allocateMemory) 
@@ -246,6 +174,26 @@ namespace Common{
                 }
             }
 
+            /**
+             * @brief Sends count consecutive items in one multi-var request, or a single item bigger than a PDU
+             * with Read/WriteArea (split) which cuts it in several PDUs (PDU Independance)
+             * @return snap7 result of the request
+             */
+            static int TransferItems(TS7Client& client, TS7DataItem* items, size_t count, bool split, Operation op)
+            {
+                if(split) {
+                    auto& item = items[0];
+                    if(op == Operation::READ)
+                        item.Result = client.ReadArea(item.Area, item.DBNumber, item.Start, item.Amount, item.WordLen, item.pdata);
+                    else
+                        item.Result = client.WriteArea(item.Area, item.DBNumber, item.Start, item.Amount, item.WordLen, item.pdata);
+                    return item.Result;
+                }
+                if(op == Operation::READ)
+                    return client.ReadMultiVars(items, static_cast<int>(count));
+                return client.WriteMultiVars(items, static_cast<int>(count));
+            }
+
             static int GetByteSizeFromAddress(const std::string& Address)
             {
                 TS7DataItem item = TS7DataItemFromAddress(Address);
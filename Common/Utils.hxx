@@ -64,6 +64,37 @@ public:
         return result;
     }
 
+    /*!
+     * Parses a duration such as "250ms", "2s" or "2" (the latter being expressed in defaultUnit)
+     * \return the duration in milliseconds, negative if the string is not a valid duration
+     */
+    static std::chrono::milliseconds ParseDuration(const std::string& str, std::chrono::milliseconds defaultUnit = std::chrono::seconds(1))
+    {
+        constexpr long MAX_VALUE = 1000L * 1000L * 1000L;
+        long value = 0;
+        size_t pos = 0;
+        while (pos < str.size() && str[pos] >= '0' && str[pos] <= '9') {
+            value = value * 10 + (str[pos] - '0');
+            if (value > MAX_VALUE) {
+                return std::chrono::milliseconds(-1);
+            }
+            ++pos;
+        }
+        if (pos == 0) {
+            return std::chrono::milliseconds(-1);
+        }
+
+        const auto suffix = str.substr(pos);
+        if (suffix.empty()) {
+            return value * defaultUnit;
+        } else if (suffix == "ms") {
+            return std::chrono::milliseconds(value);
+        } else if (suffix == "s") {
+            return std::chrono::seconds(value);
+        }
+        return std::chrono::milliseconds(-1);
+    }
+
     template <typename T>
     static T CopyNSwapBytes(const T& value)
     {
@@ -0,0 +1,137 @@
+/** © Copyright 2024 CERN
+ *
+ * This software is distributed under the terms of the
+ * GNU Lesser General Public Licence version 3 (LGPL Version 3),
+ * copied verbatim in the file “LICENSE”
+ *
+ * In applying this licence, CERN does not waive the privileges
+ * and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * Author: Alexandru Savulescu (HSE)
+ *
+ **/
+
+#include "RAMS7200AsyncSession.hxx"
+#include "Common/Constants.hxx"
+#include "Common/Logger.hxx"
+#include "Common/Metrics.hxx"
+
+RAMS7200AsyncSession::RAMS7200AsyncSession(const std::string& ip)
+    : _ip(ip), _client(new TS7Client()), _thread([this](){ run(); })
+{
+}
+
+RAMS7200AsyncSession::~RAMS7200AsyncSession()
+{
+    {
+        std::lock_guard lock{_mutex};
+        _stop = true;
+    }
+    _cv.notify_all();
+    if(_thread.joinable())
+        _thread.join();
+    _client->Disconnect();
+}
+
+void RAMS7200AsyncSession::submit(TS7DataItem* items, size_t count, bool split, Common::S7Utils::Operation op)
+{
+    {
+        std::lock_guard lock{_mutex};
+        _items = items;
+        _count = count;
+        _split = split;
+        _op = op;
+        _state = State::PENDING;
+    }
+    _cv.notify_all();
+}
+
+int RAMS7200AsyncSession::wait()
+{
+    std::unique_lock lock{_mutex};
+    _cv.wait(lock, [this](){ return _state != State::PENDING; });
+    _state = State::IDLE;
+    return _result;
+}
+
+void RAMS7200AsyncSession::connect()
+{
+    if(available()) {
+        return;
+    }
+    {
+        std::lock_guard lock{_mutex};
+        _connectRequested = true;
+    }
+    _cv.notify_all();
+}
+
+void RAMS7200AsyncSession::run()
+{
+    std::unique_lock lock{_mutex};
+    while(true) {
+        const auto connectDue = [this](){ return _connectRequested && std::chrono::steady_clock::now() >= _reconnect.nextAttempt(); };
+        if(_connectRequested) {
+            _cv.wait_until(lock, _reconnect.nextAttempt(), [&](){ return _stop || _state == State::PENDING || connectDue(); });
+        } else {
+            _cv.wait(lock, [&](){ return _stop || _state == State::PENDING || connectDue(); });
+        }
+        if(_stop) {
+            break;
+        }
+        if(_state != State::PENDING) {
+            if(connectDue()) {
+                lock.unlock();
+                tryConnect();
+                lock.lock();
+            }
+            continue;
+        }
+        lock.unlock();
+
+        int result = ERR_SESSION_NOT_CONNECTED;
+        if(available()) {
+            result = Common::S7Utils::TransferItems(*_client, _items, _count, _split, _op);
+            if(result != 0 && !_client->Connected()) {
+                // The batch goes over the main connection instead, without counting as an IO failure of the PLC
+                Common::Logger::globalWarning(__PRETTY_FUNCTION__, "Snap7: Pipeline session lost its connection to PLC IP:", _ip.c_str());
+                _client->Disconnect();
+                _connected = false;
+                result = ERR_SESSION_NOT_CONNECTED;
+            }
+        }
+
+        lock.lock();
+        _result = result;
+        _state = State::DONE;
+        _cv.notify_all();
+    }
+}
+
+void RAMS7200AsyncSession::tryConnect()
+{
+    const auto now = std::chrono::steady_clock::now();
+    // Shares the connection slots with the main connections, so that a PLC coming back does not open all its sessions at once
+    RAMS7200ReconnectPolicy::Slot slot;
+    if(!slot) {
+        _reconnect.defer(now);
+        static auto& deferred = Common::Metrics::counter("reconnect.deferred");
+        deferred.add();
+        return;
+    }
+    _client->Disconnect();
+    _client->SetConnectionParams(_ip.c_str(), Common::Constants::getLocalTsapPort(), Common::Constants::getRemoteTsapPort());
+    if(_client->Connect() != 0 || !_client->Connected()) {
+        const auto delay = _reconnect.onFailure(now);
+        Common::Logger::globalWarning(__PRETTY_FUNCTION__, ("Snap7: Pipeline session failed to connect, trying again in " + std::to_string(delay.count()) + "ms to PLC IP:").c_str(), _ip.c_str());
+        return;
+    }
+    _reconnect.onSuccess();
+    {
+        std::lock_guard lock{_mutex};
+        _connectRequested = false;
+    }
+    _connected = true;
+    Common::Logger::globalInfo(Common::Logger::L2, __PRETTY_FUNCTION__, "Snap7: Pipeline session connected to PLC IP:", _ip.c_str());
+}
@@ -0,0 +1,83 @@
+/** © Copyright 2024 CERN
+ *
+ * This software is distributed under the terms of the
+ * GNU Lesser General Public Licence version 3 (LGPL Version 3),
+ * copied verbatim in the file “LICENSE”
+ *
+ * In applying this licence, CERN does not waive the privileges
+ * and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * Author: Alexandru Savulescu (HSE)
+ *
+ **/
+
+#pragma once
+
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "snap7.h"
+#include "Common/S7Utils.hxx"
+#include "RAMS7200ReconnectPolicy.hxx"
+
+#define ERR_SESSION_NOT_CONNECTED -1    // result of a job submitted to a session that lost its connection
+
+/**
+ * @brief An additional snap7 session to a PLC, running one request at a time on its own thread.
+ *
+ * snap7 only allows one pending job per TS7Client and has no asynchronous multi-var read,
+ * so keeping N requests in flight towards a PLC takes N sessions. The facade submits a batch to
+ * a session and collects its result later with wait(), in the order the batches were submitted.
+ *
+ * The session connects on its own thread, once asked to with connect(), following its own RAMS7200ReconnectPolicy
+ * and taking a connection slot like the main connection. Only available() sessions should be given jobs: a session
+ * that is not connected, or loses its connection during a job, answers ERR_SESSION_NOT_CONNECTED.
+ */
+class RAMS7200AsyncSession
+{
+public:
+    RAMS7200AsyncSession(const std::string& ip);
+    RAMS7200AsyncSession(const RAMS7200AsyncSession&) = delete;
+    RAMS7200AsyncSession& operator=(const RAMS7200AsyncSession&) = delete;
+    ~RAMS7200AsyncSession();
+
+    // Starts the transfer of the items, see Common::S7Utils::TransferItems. The previous job must have been waited for.
+    void submit(TS7DataItem* items, size_t count, bool split, Common::S7Utils::Operation op);
+
+    // Waits for the submitted job and returns its snap7 result
+    int wait();
+
+    // Connected, ready to take jobs
+    bool available() const { return _connected.load(std::memory_order_relaxed); }
+    // Asks for the session to be connected, in the background, when the reconnect policy allows it
+    void connect();
+
+private:
+    enum class State {IDLE, PENDING, DONE};
+
+    void run();
+    // Must be called from the session thread without holding _mutex
+    void tryConnect();
+
+    const std::string _ip;
+    std::unique_ptr<TS7Client> _client;
+    std::atomic<bool> _connected{false};
+    RAMS7200ReconnectPolicy _reconnect;     // only used by the session thread
+
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    State _state{State::IDLE};
+    bool _stop{false};
+    bool _connectRequested{false};
+    TS7DataItem* _items{nullptr};
+    size_t _count{0};
+    bool _split{false};
+    Common::S7Utils::Operation _op{Common::S7Utils::Operation::READ};
+    int _result{0};
+
+    std::thread _thread;    // last, so that it starts once everything else is initialized
+};
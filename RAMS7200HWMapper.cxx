@@ -27,6 +27,7 @@
 #include "Common/Constants.hxx"
 #include "Common/Utils.hxx"
 #include "Common/S7Utils.hxx"
+#include "Common/Metrics.hxx"
 #include <PVSSMacros.hxx>     // DEBUG macros
 
 
@@ -103,13 +104,24 @@ PVSSboolean RAMS7200HWMapper::addDpPa(DpIdentifier &dpId, PeriphAddr *confPtr)
   // Add it to the list
   addHWObject(hwObj);
 
-  if( (confPtr->getDirection() == DIRECTION_IN || confPtr->getDirection() == DIRECTION_INOUT) && (addressOptions.size() == 3) ) {
+  // IP + VAR + POLLTIME, and optionally smoothing options
+  if( (confPtr->getDirection() == DIRECTION_IN || confPtr->getDirection() == DIRECTION_INOUT) && (addressOptions.size() == 3 || addressOptions.size() == 4) ) {
     if(!Common::S7Utils::AddressIsValid(addressOptions[1])){
       Common::Logger::globalError(__PRETTY_FUNCTION__, "Address is not valid!", CharString(confPtr->getName()));
       return PVSS_FALSE;
     }
+    if(Common::Utils::ParseDuration(addressOptions[2]).count() < 0){
+      Common::Logger::globalError(__PRETTY_FUNCTION__, "Poll time is not valid!", CharString(confPtr->getName()));
+      return PVSS_FALSE;
+    }
+    const std::string options = addressOptions.size() == 4 ? addressOptions[3] : "";
+    RAMS7200TagFilter filter;
+    if(!RAMS7200TagFilter::Parse(options, filter)){
+      Common::Logger::globalError(__PRETTY_FUNCTION__, "Smoothing options are not valid!", CharString(confPtr->getName()));
+      return PVSS_FALSE;
+    }
     // TODO: add warning if requested transformation is not the same as the s7 type
-    addAddress(addressOptions[0], addressOptions[1], addressOptions[2]);
+    addAddress(addressOptions[0], addressOptions[1], addressOptions[2], options, valueType(confPtr->getTransformationType()), hwObj);
   }
 
   return PVSS_TRUE;
@@ -138,9 +150,9 @@ PVSSboolean RAMS7200HWMapper::clrDpPa(DpIdentifier &dpId, PeriphAddr *confPtr)
 
   if(confPtr->getDirection() == DIRECTION_IN || confPtr->getDirection() == DIRECTION_INOUT)
   {
-      if (addressOptions.size() == 3) // IP + VAR + POLLTIME
+      if (addressOptions.size() == 3 || addressOptions.size() == 4) // IP + VAR + POLLTIME (+ OPTIONS)
       {
-        removeAddress(addressOptions[0], addressOptions[1], addressOptions[2]);
+        removeAddress(addressOptions[0], addressOptions[1], hwObj);
       }
   }
 
@@ -154,8 +166,36 @@ PVSSboolean RAMS7200HWMapper::clrDpPa(DpIdentifier &dpId, PeriphAddr *confPtr)
   return HWMapper::clrDpPa(dpId, confPtr);
 }
 
-void RAMS7200HWMapper::addAddress(const std::string &ip, const std::string &var, const std::string &pollTime)
+RAMS7200ValueType RAMS7200HWMapper::valueType(int transformationType)
 {
+  switch (transformationType) {
+    case RAMS7200DrvUint8TransType:
+      return RAMS7200ValueType::UINT8;
+    case RAMS7200DrvUInt16TransType:
+      return RAMS7200ValueType::UINT16;
+    case RAMS7200DrvUInt32TransType:
+      return RAMS7200ValueType::UINT32;
+    case RAMS7200DrvFloatTransType:
+      return RAMS7200ValueType::FLOAT;
+    default:
+      return RAMS7200ValueType::RAW;
+  }
+}
+
+void RAMS7200HWMapper::addAddress(const std::string &ip, const std::string &var, const std::string &pollTime, const std::string &options, RAMS7200ValueType valueType, HWObject* hwObj)
+{
+  if(_bulkIngest)
+  {
+    // Startup: the address was validated by addDpPa, the PLC is created at start
+    if(_pendingCount++ == 0)
+      _firstAddress = std::chrono::steady_clock::now();
+    _pendingAddresses[ip].emplace_back(RAMS7200MSVarConfig{var, pollTime, options, valueType, hwObj});
+    return;
+  }
+
+  if(!Common::S7Utils::AddressIsValid(var))
+    return;
+
   auto msIt = RAMS7200MSs.find(ip);
   if(msIt == RAMS7200MSs.end())
   {
@@ -163,32 +203,66 @@ void RAMS7200HWMapper::addAddress(const std::string &ip, const std::string &var,
           std::forward_as_tuple(ip),
           std::forward_as_tuple(RAMS7200MS{ip})).first;
     Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__, "New RAMS7200MS device incoming, IP : " + CharString(msIt->second._ip.c_str()));
-    if(_newMSCB){
-      _newMSCB(msIt->second);
-    }
   }
+  // A running PLC takes the address as a delta of its read plan, without reconnecting
+  msIt->second.addVar(var, pollTime, options, valueType, hwObj);
   if(!msIt->second._run.load() && _newMSCB){
       _newMSCB(msIt->second);
   }
-  if(Common::S7Utils::AddressIsValid(var))
-    msIt->second.addVar(var, std::stoi(pollTime));   
 }
 
 
-void RAMS7200HWMapper::removeAddress(const std::string &ip, const std::string &var, const std::string &pollTime)
+void RAMS7200HWMapper::endBulkIngest()
 {
-  auto msIt = RAMS7200MSs.find(ip);
-  if(msIt != RAMS7200MSs.end()) {
+  if(!_bulkIngest)
+    return;
+  const auto start = std::chrono::steady_clock::now();
+  for(auto& [ip, configs] : _pendingAddresses)
+  {
+    auto msIt = RAMS7200MSs.emplace(std::piecewise_construct,
+          std::forward_as_tuple(ip),
+          std::forward_as_tuple(ip)).first;
+    msIt->second.addVars(configs);
+  }
+  const auto end = std::chrono::steady_clock::now();
+  _bulkIngest = false;
+
+  Common::Logger::globalInfo(Common::Logger::L1, __PRETTY_FUNCTION__, ("Created " + std::to_string(RAMS7200MSs.size()) + " PLCs with " + std::to_string(_pendingCount) + " addresses").c_str());
+  Common::Metrics::set("startup.addresses", _pendingCount);
+  Common::Metrics::set("startup.plcs", RAMS7200MSs.size());
+  Common::Metrics::set("startup.ingestMs", _pendingCount ? std::chrono::duration_cast<std::chrono::milliseconds>(start - _firstAddress).count() : 0);
+  Common::Metrics::set("startup.buildMs", std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count());
+  _pendingAddresses.clear();
+  _pendingCount = 0;
+}
+
+void RAMS7200HWMapper::removeAddress(const std::string &ip, const std::string &var, const HWObject* hwObj)
+{
+  if(_bulkIngest)
+  {
+    auto pendingIt = _pendingAddresses.find(ip);
+    if(pendingIt != _pendingAddresses.end())
     {
-        std::lock_guard lk(msIt->second._threadMutex);
-        msIt->second._run.store(false);
+      auto& configs = pendingIt->second;
+      const auto removed = std::remove_if(configs.begin(), configs.end(), [&](const RAMS7200MSVarConfig& config){ return config.hwObject == hwObj; });
+      _pendingCount -= std::distance(removed, configs.end());
+      configs.erase(removed, configs.end());
+      if(configs.empty())
+        _pendingAddresses.erase(pendingIt);
     }
-    msIt->second._threadCv.notify_all();
-    msIt->second.removeVar(var);
+    return;
+  }
+
+  auto msIt = RAMS7200MSs.find(ip);
+  if(msIt != RAMS7200MSs.end()) {
+    // The other addresses of the PLC keep being polled on the same connection
+    msIt->second.removeVar(var, hwObj);
     if(msIt->second.isEmpty()) {
       Common::Logger::globalInfo(Common::Logger::L1, __PRETTY_FUNCTION__,  "All Addresses deleted for IP : " + CharString(ip.c_str()));
-      RAMS7200MSs.erase(msIt);
+      auto removed = RAMS7200MSs.extract(msIt);
+      if(_removedMSCB)
+        _removedMSCB(std::move(removed));
     }
   }
-  
+
 }
@@ -29,6 +29,7 @@
 #define RAMS7200DrvStringTransType (TransUserType + 5)
 
 using newMSCB = std::function<void(RAMS7200MS&)>;
+using removedMSCB = std::function<void(RAMS7200MSNode&&)>;
 
 class RAMS7200HWMapper : public HWMapper
 {
@@ -38,12 +39,29 @@ class RAMS7200HWMapper : public HWMapper
 
     std::unordered_map<std::string, RAMS7200MS>& getRAMS7200MSs(){return RAMS7200MSs;}
     void setNewMSCallback(newMSCB cb){_newMSCB = cb;}
+    // Called when the last address of a PLC is removed, handing the PLC over so that it outlives its session
+    void setRemovedMSCallback(removedMSCB cb){_removedMSCB = cb;}
+    /**
+     * @brief Ends the startup burst of addDpPa (called by start): creates the PLCs and their addresses recorded until then, in one pass.
+     * Addresses received afterwards are added one by one.
+     */
+    void endBulkIngest();
 
   private:
-    void addAddress(const std::string &ip, const std::string &var, const std::string &pollTime);
-    void removeAddress(const std::string& ip, const std::string& var, const std::string &pollTime);
+    void addAddress(const std::string &ip, const std::string &var, const std::string &pollTime, const std::string &options, RAMS7200ValueType valueType, HWObject* hwObj);
+    // Value type of the deadbands, from the transformation of the address
+    static RAMS7200ValueType valueType(int transformationType);
+    // Removes the address of an HWObject: other addresses of the same PLC location keep it read
+    void removeAddress(const std::string& ip, const std::string& var, const HWObject* hwObj);
     std::unordered_map<std::string, RAMS7200MS> RAMS7200MSs;
     newMSCB _newMSCB{nullptr};
+    removedMSCB _removedMSCB{nullptr};
+
+    // Until endBulkIngest, addresses are only recorded, per IP
+    bool _bulkIngest{true};
+    std::unordered_map<std::string, std::vector<RAMS7200MSVarConfig>> _pendingAddresses;
+    size_t _pendingCount{0};
+    std::chrono::steady_clock::time_point _firstAddress{};
 
     enum Direction
     {
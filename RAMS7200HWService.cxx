@@ -21,6 +21,7 @@
 #include "Common/Logger.hxx"
 #include "Common/Constants.hxx"
 #include "Common/Utils.hxx"
+#include "Common/Metrics.hxx"
 
 #include "RAMS7200HWMapper.hxx"
 #include "RAMS7200LibFacade.hxx"
@@ -51,6 +52,7 @@ PVSSboolean RAMS7200HWService::initialize(int argc, char *argv[])
 
   // add callback for new MS
   static_cast<RAMS7200HWMapper*>(DrvManager::getHWMapperPtr())->setNewMSCallback(_newMSCB);
+  static_cast<RAMS7200HWMapper*>(DrvManager::getHWMapperPtr())->setRemovedMSCallback(_removedMSCB);
 
   Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__,"RAMS7200 Driver initialization of Internal vars end");
   // To stop driver return PVSS_FALSE
@@ -58,69 +60,123 @@ PVSSboolean RAMS7200HWService::initialize(int argc, char *argv[])
 }
 
 
-void RAMS7200HWService::queueToDP(std::vector<toDPTriple>&& payload)
+void RAMS7200HWService::queueToDP(const std::string& source, RAMS7200ToDPBatch&& batch)
 {
-  std::lock_guard lock{_toDPmutex};
-  for(auto& item : payload)
-  {
-    _toDPqueue.emplace(std::move(item));
-  }
+  if(batch.items.empty())
+    return;
+  batch.source = source;
+  _toDPpending += batch.items.size();
+  _toDPqueue.push(std::move(batch));
 }
 
 void RAMS7200HWService::handleNewMS(RAMS7200MS& ms)
 {
-  std::lock_guard lock{_toDPmutex};
+  reapStoppedMSs();
+  std::lock_guard lock{_sessionsMutex};
   ms._run = true;
+  queueToDPCallback cb{[this, &ms](RAMS7200ToDPBatch&& batch){ this->queueToDP(ms._ip, std::move(batch)); }};
+
+  const auto workerThreads = Common::Constants::getWorkerThreads();
+  if(workerThreads > 0) {
+    // The PLCs share a fixed number of threads
+    if(!_workerPool)
+    {
+      _workerPool = std::make_unique<RAMS7200WorkerPool>(workerThreads);
+    }
+    _workerPool->add(ms, std::move(cb));
+    return;
+  }
 
   // PLC thread
-  _plcThreads.emplace_back(std::thread([&]() {
+  _plcThreads[&ms] = std::thread([&ms, cb]() {
     Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__, "Thread up for PLC IP" + CharString(ms._ip.c_str()));
     
-    RAMS7200LibFacade aFacade(ms, this->_queueToDPCB);
-    aFacade.Connect();
-    const auto cycleInterval = std::chrono::seconds(Common::Constants::getCycleInterval());
-    while(_driverRun && ms._run)
     {
-      aFacade.EnsureConnection();
-      if(!RAMS7200Resources::getDisableCommands()) {
-        // The Server is Active (for redundant systems)
-        Common::Logger::globalInfo(Common::Logger::L2,__PRETTY_FUNCTION__, "Polling:", ms._ip.c_str());
-        const auto start = std::chrono::steady_clock::now();
-        //First do all the writes for this IP, then the reads
-        aFacade.WriteToPLC();
-        aFacade.Poll();                         
-        const auto end = std::chrono::steady_clock::now();
-        const auto time_elapsed = end - start;
-        
-        // If we still have time left, then sleep
-        if(time_elapsed < cycleInterval)
-          aFacade.sleep_for(cycleInterval- time_elapsed);
-      } else {
-        // The Server is Passive (for redundant systems)
-        aFacade.sleep_for( std::chrono::seconds(1));
+      RAMS7200LibFacade aFacade(ms, cb);
+      while(_driverRun && ms._run)
+      {
+        // Sleep until the next group of variables is due, or a write is queued
+        const auto wakeUp = aFacade.RunOnce();
+        if(wakeUp > std::chrono::steady_clock::now())
+          aFacade.sleep_until(wakeUp);
       }
     }
-  }));
+    // The facade closed the connection on the way out
+    ms._sessionDone = true;
+  });
 
 }
 
+void RAMS7200HWService::handleRemovedMS(RAMS7200MSNode&& node)
+{
+  auto& ms = node.mapped();
+  {
+    std::lock_guard lk(ms._threadMutex);
+    ms._run.store(false);
+  }
+  ms._threadCv.notify_all();
+
+  // The iteration in progress of the PLC loop can take as long as a connection timeout: it is not waited for here
+  std::lock_guard lock{_sessionsMutex};
+  auto it = _plcThreads.find(&ms);
+  if(it != _plcThreads.end())
+  {
+    _stoppedMSs.push_back(StoppedMS{std::move(node), std::move(it->second)});
+    _plcThreads.erase(it);
+  }
+  else if(_workerPool && _workerPool->stop(ms))
+  {
+    _stoppedMSs.push_back(StoppedMS{std::move(node), std::thread()});
+  }
+  else
+  {
+    // No session ever ran the PLC, it is deleted right away
+    Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__, "Stopped PLC IP" + CharString(ms._ip.c_str()));
+    return;
+  }
+  Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__, "Stopping PLC IP" + CharString(ms._ip.c_str()));
+}
+
+void RAMS7200HWService::reapStoppedMSs()
+{
+  for(auto it = _stoppedMSs.begin(); it != _stoppedMSs.end();)
+  {
+    const auto& ms = it->ms.mapped();
+    if(!ms._sessionDone)
+    {
+      ++it;
+      continue;
+    }
+    // The thread is done with the PLC, and about to return
+    if(it->thread.joinable())
+      it->thread.join();
+    Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__, "Stopped PLC IP" + CharString(ms._ip.c_str()));
+    // Its entry in the toDP sources goes away once its last values are sent
+    const auto source = _toDPsources.find(ms._ip);
+    if(source != _toDPsources.end() && source->second.batches.empty())
+      _toDPsources.erase(source);
+    it = _stoppedMSs.erase(it);
+  }
+}
+
 //--------------------------------------------------------------------------------
 // called after connect to event
 
 PVSSboolean RAMS7200HWService::start()
 {
   // use this function to start your hardware activity.  
-  // The ms list is automatically built by exisiting addresses sent at driver startup
-  for (auto& msIt : static_cast<RAMS7200HWMapper*>(DrvManager::getHWMapperPtr())->getRAMS7200MSs() )
+  // The ms list is built in one pass from the addresses sent at driver startup
+  auto mapper = static_cast<RAMS7200HWMapper*>(DrvManager::getHWMapperPtr());
+  mapper->endBulkIngest();
+  for (auto& msIt : mapper->getRAMS7200MSs() )
   {
       this->handleNewMS(msIt.second);
   }
 
   //Write Driver version
-  char* DrvVersion = new char[Common::Constants::getDrvVersion().size()+1];
-  std::strcpy(DrvVersion, Common::Constants::getDrvVersion().c_str());
-  Common::Logger::globalInfo(Common::Logger::L1, __PRETTY_FUNCTION__, "RAMS7200 Sent Driver version: " + CharString(DrvVersion));
-  queueToDP({std::make_tuple("_VERSION", Common::Constants::getDrvVersion().size() + 1, DrvVersion)});
+  const auto& DrvVersion = Common::Constants::getDrvVersion();
+  Common::Logger::globalInfo(Common::Logger::L1, __PRETTY_FUNCTION__, "RAMS7200 Sent Driver version: " + CharString(DrvVersion.c_str()));
+  queueToDP("", RAMS7200ToDPBatch({std::make_tuple(_versionTag, DrvVersion.size() + 1, Common::BufferPool::Slice::copyOf(DrvVersion.c_str(), DrvVersion.size() + 1))}));
 
   return PVSS_TRUE;
 }
@@ -139,49 +195,166 @@ void RAMS7200HWService::stop()
       msIt.second._threadCv.notify_all();
   }
 
-  for(auto& pt : _plcThreads)
+  for(auto& [_, pt] : _plcThreads)
   {
     if(pt.joinable())
         pt.join();
   }
+  _plcThreads.clear();
+  for(auto& stopped : _stoppedMSs)
+  {
+    if(stopped.thread.joinable())
+      stopped.thread.join();
+  }
+  // The removed PLCs are deleted after the pool, which may still have their sessions
+  _workerPool.reset();
+  _stoppedMSs.clear();
 
 }
 
 //--------------------------------------------------------------------------------
 
+void RAMS7200HWService::publishMetrics()
+{
+  const auto interval = Common::Constants::getMetricsInterval();
+  const auto now = std::chrono::steady_clock::now();
+  if(interval.count() == 0 || now - _lastMetrics < interval)
+    return;
+  _lastMetrics = now;
+
+  // Only published if the _METRICS address is configured
+  HWObject obj;
+  obj.setAddress(_metricsTag->dpAddress);
+  if(!DrvManager::getHWMapperPtr()->findHWObject(&obj))
+    return;
+
+  Common::Metrics::set("bufferPool.allocations", Common::BufferPool::allocations());
+  Common::Metrics::set("bufferPool.reuses", Common::BufferPool::reuses());
+  Common::Metrics::set("bufferPool.freeChunks", Common::BufferPool::freeChunks());
+  Common::Metrics::set("toDP.pending", _toDPpending.load());
+  Common::Metrics::set("toDP.racedPops", _toDPqueue.racedPops());
+  Common::Metrics::set("toDP.pendingSources", _toDPbusySources);
+  Common::Metrics::set("reconnect.openCircuits", RAMS7200ReconnectPolicy::openCircuits());
+
+  const auto metrics = Common::Metrics::toString();
+  Common::Logger::globalInfo(Common::Logger::L2, __PRETTY_FUNCTION__, metrics.c_str());
+  queueToDP("", RAMS7200ToDPBatch({std::make_tuple(_metricsTag, metrics.size() + 1, Common::BufferPool::Slice::copyOf(metrics.c_str(), metrics.size() + 1))}));
+}
+
 void RAMS7200HWService::workProc()
 {
+  publishMetrics();
+  if(!_stoppedMSs.empty())
+    reapStoppedMSs();
 
   HWObject obj;
   const TimeVar work_time{};
+  const bool acquisitionTimestamps = Common::Constants::getAcquisitionTimestamps();
 
-  std::lock_guard lock{_toDPmutex};
-
-  while (!_toDPqueue.empty())
+  // No lock: the PLC threads keep queuing while the values are sent to WinCC OA
+  RAMS7200ToDPBatch batch;
+  uint64_t batches = 0;
+  while (_toDPqueue.pop(batch))
   {
-    auto item = std::move(_toDPqueue.front());
-    _toDPqueue.pop();
-
-    obj.setAddress(std::get<0>(item));
-    
-    // find the HWObject via the periphery address in the HWObject list,
-    HWObject *addrObj = DrvManager::getHWMapperPtr()->findHWObject(&obj);
+    ++batches;
+    auto& source = _toDPsources[batch.source];
+    if(source.batches.empty())
+      ++_toDPbusySources;
+    source.batches.emplace_back(std::move(batch));
+  }
 
-    // ok, we found it; now send to the DPEs
-    if ( addrObj )
+  // Send the values in turns of a few items per PLC, until the budget of this call is exhausted.
+  // What is left is sent by the next calls, so that a burst (e.g. after a reconnection) does not freeze the manager.
+  const auto budget = Common::Constants::getWorkProcBudget();
+  const auto maxItems = Common::Constants::getWorkProcMaxItems();
+  const auto deadline = std::chrono::steady_clock::now() + budget;
+  int64_t sent = 0;
+  bool budgetLeft = true;
+  while (budgetLeft && _toDPbusySources > 0)
+  {
+    // Drained sources are skipped, there is at least one with batches
+    auto sourceIt = _toDPsources.upper_bound(_lastSource);
+    while(sourceIt == _toDPsources.end() || sourceIt->second.batches.empty())
+      sourceIt = sourceIt == _toDPsources.end() ? _toDPsources.begin() : std::next(sourceIt);
+    _lastSource = sourceIt->first;
+
+    auto& source = sourceIt->second;
+    const auto metrics = sourceIt->first.empty() ? nullptr : &sourceMetrics(sourceIt->first);
+    for(size_t turn = 0; turn < TODP_TURN_SIZE && !source.batches.empty(); ++turn)
     {
-        //addrObj->debugPrint();
-        obj.setOrgTime(work_time);  // current time
-        obj.setDlen(std::get<1>(item)); //length
-        obj.setData((PVSSchar*)(std::move(std::get<2>(item)))); //data
-        obj.setObjSrcType(srcPolled);
-
-        if( DrvManager::getSelfPtr()->toDp(&obj, addrObj) != PVSS_TRUE) {
-          Common::Logger::globalWarning(__PRETTY_FUNCTION__, "Problem in sending item's value to PVSS for address: " + std::get<0>(item));
-        }
-    } else {
-        Common::Logger::globalWarning(__PRETTY_FUNCTION__, "Problem in getting HWObject for the address: " + std::get<0>(item));   
+      auto& front = source.batches.front();
+      const auto start = std::chrono::steady_clock::now();
+      if(metrics && source.next == 0)
+        metrics->queueWait.record(std::chrono::duration_cast<std::chrono::microseconds>(start - front.readDone));
+      // Moved out, so that the slice goes back to the pool as soon as it was sent
+      auto item = std::move(front.items[source.next]);
+      sendToDp(obj, item, acquisitionTimestamps ? toTimeVar(front.acquired) : work_time);
+      ++sent;
+      source.dispatch += std::chrono::steady_clock::now() - start;
+      if(++source.next == front.items.size())
+      {
+        if(metrics)
+          metrics->dispatch.record(std::chrono::duration_cast<std::chrono::microseconds>(source.dispatch));
+        source.batches.pop_front();
+        source.next = 0;
+        source.dispatch = {};
+      }
     }
+    if(source.batches.empty())
+      --_toDPbusySources;
+
+    budgetLeft = (maxItems == 0 || sent < static_cast<int64_t>(maxItems)) && (budget.count() == 0 || std::chrono::steady_clock::now() < deadline);
+  }
+  _toDPpending -= sent;
+
+  if(batches)
+    _batchesMetric.add(batches);
+  if(_toDPbusySources > 0)
+    _carryOversMetric.add();
+}
+
+RAMS7200HWService::SourceMetrics& RAMS7200HWService::sourceMetrics(const std::string& source)
+{
+  auto it = _sourceMetrics.find(source);
+  if(it == _sourceMetrics.end())
+    it = _sourceMetrics.emplace(source, SourceMetrics{Common::Metrics::histogram(source + ".queueWait"), Common::Metrics::histogram(source + ".dispatch")}).first;
+  return it->second;
+}
+
+TimeVar RAMS7200HWService::toTimeVar(std::chrono::system_clock::time_point time)
+{
+  const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+  return TimeVar(static_cast<PVSSlong>(ms / 1000), static_cast<PVSSshort>(ms % 1000));
+}
+
+void RAMS7200HWService::sendToDp(HWObject& obj, toDPTriple& item, const TimeVar& time)
+{
+  const auto& tag = std::get<0>(item);
+
+  // the HWObject resolved at addDpPa, else find it via the periphery address in the HWObject list
+  HWObject *addrObj = tag->hwObject();
+  if ( !addrObj )
+  {
+    obj.setAddress(tag->dpAddress);
+    addrObj = DrvManager::getHWMapperPtr()->findHWObject(&obj);
+  }
+
+  // ok, we found it; now send to the DPEs
+  if ( addrObj )
+  {
+      //addrObj->debugPrint();
+      obj.setOrgTime(time);  // current time
+      obj.setDlen(std::get<1>(item)); //length
+      obj.setData((PVSSchar*)(std::get<2>(item).data())); //data, still owned by the slice
+      obj.setObjSrcType(srcPolled);
+
+      if( DrvManager::getSelfPtr()->toDp(&obj, addrObj) != PVSS_TRUE) {
+        Common::Logger::globalWarning(__PRETTY_FUNCTION__, "Problem in sending item's value to PVSS for address: " + tag->dpAddress);
+      }
+      // The value was converted by toDp: detach the slice data so that the HWObject does not free it
+      obj.cutData();
+  } else {
+      Common::Logger::globalWarning(__PRETTY_FUNCTION__, "Problem in getting HWObject for the address: " + tag->dpAddress);
   }
 }
 
@@ -208,7 +381,7 @@ PVSSboolean RAMS7200HWService::writeData(HWObject *objPtr)
           Common::Logger::globalWarning(__PRETTY_FUNCTION__, "No configuration handling for address:", CharString(objPtr->getAddress().c_str()) + ':' + CharString(e.what()));
       }
   }
-  else if (addressOptions.size() == ADDRESS_OPTIONS_SIZE) // Send to PLC
+  else if (addressOptions.size() == ADDRESS_OPTIONS_FILTER || addressOptions.size() == ADDRESS_OPTIONS_SIZE) // Send to PLC
   {
 
     if(!addressOptions[ADDRESS_OPTIONS_IP].length())
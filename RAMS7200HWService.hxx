@@ -19,15 +19,23 @@
 #include <HWService.hxx>
 #include "RAMS7200MS.hxx"
 #include "RAMS7200LibFacade.hxx"
+#include "RAMS7200WorkerPool.hxx"
 #include "Common/Logger.hxx"
+#include "Common/MpscQueue.hxx"
+#include "Common/Metrics.hxx"
 
 #include <memory>
 #include <queue>
 #include <chrono>
 #include <thread>
 #include <unordered_map>
+#include <map>
+#include <deque>
+#include <vector>
 #include <tuple>
 
+#define TODP_TURN_SIZE 64     // values sent for a PLC before workProc moves on to the next one
+
 class RAMS7200HWService : public HWService
 {
   public:
@@ -40,25 +48,69 @@ class RAMS7200HWService : public HWService
     int CheckIP(std::string);
 
   private:
-    void queueToDP(std::vector<toDPTriple>&&);
+    void queueToDP(const std::string& source, RAMS7200ToDPBatch&&);
     void handleNewMS(RAMS7200MS&);
+    // Stops the session of a PLC which has no address left, without waiting for it: the PLC is deleted by reapStoppedMSs
+    void handleRemovedMS(RAMS7200MSNode&&);
+    // Deletes the removed PLCs whose session is gone
+    void reapStoppedMSs();
+    void publishMetrics();
+    void sendToDp(HWObject& obj, toDPTriple& item, const TimeVar& time);
+    static TimeVar toTimeVar(std::chrono::system_clock::time_point time);
 
-    queueToDPCallback  _queueToDPCB{[this](std::vector<toDPTriple>&& payload){this->queueToDP(std::move(payload));}};
     std::function<void(RAMS7200MS&)> _newMSCB{[this](RAMS7200MS& ms){this->handleNewMS(ms);}};
+    std::function<void(RAMS7200MSNode&&)> _removedMSCB{[this](RAMS7200MSNode&& ms){this->handleRemovedMS(std::move(ms));}};
 
     //Common
-    std::mutex _toDPmutex;
-    std::queue<toDPTriple> _toDPqueue;
+    std::mutex _sessionsMutex;  // guards the PLC sessions: _plcThreads and _workerPool
+    // Batches of values from the PLC threads to workProc: producers never wait for workProc
+    Common::MpscQueue<RAMS7200ToDPBatch> _toDPqueue;
+    std::atomic<int64_t> _toDPpending{0};     // values queued and not yet sent by workProc
+
+    // Values taken from _toDPqueue but not sent yet (workProc budget exhausted), per source. Only used by workProc.
+    struct PendingSource
+    {
+        std::deque<RAMS7200ToDPBatch> batches;
+        size_t next{0};     // next item to send in the first batch
+        std::chrono::steady_clock::duration dispatch{0};    // time spent sending the first batch so far
+    };
+    // Drained sources are kept, so that a PLC does not allocate its entry again at each poll: they are erased with their PLC
+    std::map<std::string, PendingSource> _toDPsources;
+    size_t _toDPbusySources{0};     // sources with batches left
+    std::string _lastSource;    // round robin: workProc resumes with the source after this one
+
+    // Latency histograms of a source, resolved once. Only used by workProc.
+    struct SourceMetrics
+    {
+        Common::Metrics::Histogram& queueWait;
+        Common::Metrics::Histogram& dispatch;
+    };
+    SourceMetrics& sourceMetrics(const std::string& source);
+    std::unordered_map<std::string, SourceMetrics> _sourceMetrics;
+    Common::Metrics::Counter& _batchesMetric{Common::Metrics::counter("toDP.batches")};
+    Common::Metrics::Counter& _carryOversMetric{Common::Metrics::counter("toDP.carryOvers")};
 
     enum
     {
        ADDRESS_OPTIONS_IP = 0,
        ADDRESS_OPTIONS_VAR,
        ADDRESS_OPTIONS_POLLTIME,
+       ADDRESS_OPTIONS_FILTER,  // optional
        ADDRESS_OPTIONS_SIZE
     } ADDRESS_OPTIONS;
 
-    std::vector<std::thread> _plcThreads;
+    std::unordered_map<const RAMS7200MS*, std::thread> _plcThreads;     // one per running PLC
+    // Removed PLCs whose session may still be running, with their thread. Only used from the WinCC OA main thread.
+    struct StoppedMS
+    {
+        RAMS7200MSNode ms;
+        std::thread thread;
+    };
+    std::vector<StoppedMS> _stoppedMSs;
+    std::unique_ptr<RAMS7200WorkerPool> _workerPool;    // workerThreads > 0
+    std::chrono::steady_clock::time_point _lastMetrics{};
+    const RAMS7200TagHandle _versionTag{RAMS7200Tag::makeInternal("_VERSION")};
+    const RAMS7200TagHandle _metricsTag{RAMS7200Tag::makeInternal("_METRICS")};
 };
 
 
@@ -18,55 +18,123 @@
 #include "RAMS7200Resources.hxx"
 #include "Common/Constants.hxx"
 #include "Common/Logger.hxx"
+#include "Common/S7Coalescer.hxx"
+#include "Common/Metrics.hxx"
+#include "Common/ChangeDetector.hxx"
+#include "Common/S7Address.hxx"
 #include <thread>
 #include <algorithm>
 #include <vector>
 #include <sstream>
-#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <unordered_map>
 
 
 RAMS7200LibFacade::RAMS7200LibFacade(RAMS7200MS& ms, queueToDPCallback cb)
-    : ms(ms), _queueToDPCB(cb)
+    : ms(ms), _queueToDPCB(cb), _errorTag(RAMS7200Tag::makeInternal(ms._ip + "._system$_Error")),
+      _readRttMetric(Common::Metrics::histogram(ms._ip + ".readRtt")),
+      _writeConfirmLatencyMetric(Common::Metrics::histogram(ms._ip + ".writeConfirmLatency")),
+      _connectFailuresMetric(Common::Metrics::counter(ms._ip + ".connectFailures"))
 {
+     const auto depth = Common::Constants::getPipelineDepth();
+     for(uint32_t i = 0; depth > 1 && i < depth; ++i) {
+        _sessions.emplace_back(std::make_unique<RAMS7200AsyncSession>(ms._ip));
+     }
      Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__, "Initialized LibFacade with PLC IP: "+ CharString(ms._ip.c_str()));
 }
 
 
-void RAMS7200LibFacade::EnsureConnection() {
-    if(_client->Connected() && _wasConnected && ioFailures < Common::Constants::getMaxIoFailures()){
+std::chrono::steady_clock::time_point RAMS7200LibFacade::RunOnce()
+{
+    const auto start = std::chrono::steady_clock::now();
+    _writesEnabled = false;
+    if(!EnsureConnection()) {
+        // Also checked again when a write is queued, which is ignored while not connected
+        return _reconnect.nextAttempt();
+    }
+    if(RAMS7200Resources::getDisableCommands()) {
+        // The Server is Passive (for redundant systems)
+        return start + std::chrono::seconds(1);
+    }
+    // The Server is Active (for redundant systems)
+    _writesEnabled = true;
+    // The pipeline sessions connect in the background, only while the main connection is up
+    for(auto& session : _sessions) {
+        session->connect();
+    }
+    Common::Logger::globalInfo(Common::Logger::L2,__PRETTY_FUNCTION__, "Polling:", ms._ip.c_str());
+    //First do all the writes for this IP, then the reads
+    WriteToPLC();
+    Poll();
+    // Next group of variables due, at least once per cycle to check the connection
+    return std::min(NextDeadline(), start + Common::Constants::getCycleInterval());
+}
+
+bool RAMS7200LibFacade::EnsureConnection() {
+    if(_client && _client->Connected() && _wasConnected && ioFailures < Common::Constants::getMaxIoFailures()){
         RAMS7200MarkDeviceConnectionError(false);
-        return;
-    } else {
-        if (_wasConnected) {
-            Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__, "Snap7: Connection lost with PLC IP: ", ms._ip.c_str());
-            RAMS7200MarkDeviceConnectionError(true);
+        return true;
+    }
+    if (_wasConnected) {
+        Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__, "Snap7: Connection lost with PLC IP: ", ms._ip.c_str());
+        RAMS7200MarkDeviceConnectionError(true);
+        Disconnect();
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if(now < _reconnect.nextAttempt()) {
+        return false;
+    }
+    // Bounded number of connection attempts at once, so that a whole substation coming back does not flood the network
+    RAMS7200ReconnectPolicy::Slot slot;
+    if(!slot) {
+        _reconnect.defer(now);
+        static auto& deferred = Common::Metrics::counter("reconnect.deferred");
+        deferred.add();
+        return false;
+    }
+    Connect();
+
+    if(!_wasConnected) {
+        const bool wasOpen = _reconnect.isOpen();
+        const auto delay = _reconnect.onFailure(now);
+        _connectFailuresMetric.add();
+        if(_reconnect.isOpen() && !wasOpen) {
+            Common::Logger::globalWarning(__PRETTY_FUNCTION__, ("Circuit open after " + std::to_string(_reconnect.failures()) + " failed connection attempts, next attempt in " + std::to_string(delay.count()) + "ms for PLC IP:").c_str(), ms._ip.c_str());
+        } else {
+            Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__, ("Failure in connection. Trying again in " + std::to_string(delay.count()) + "ms for PLC IP:").c_str(), ms._ip.c_str());
         }
-        do {
-            //Disconnect and try to connect again.
-            Disconnect();
-            Connect();
-
-            if(!_client->Connected()) {
-                Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__, "Failure in re-connection. Trying again in 5 seconds for PLC IP:" + CharString(ms._ip.c_str()));
-                RAMS7200MarkDeviceConnectionError(true);
-                sleep_for(std::chrono::seconds(5));
-            }
-        } while(ms._run && !_wasConnected);
-        RAMS7200MarkDeviceConnectionError(!_wasConnected);
+        RAMS7200MarkDeviceConnectionError(true);
+        return false;
     }
+    _reconnect.onSuccess();
+    RAMS7200MarkDeviceConnectionError(false);
+    return true;
 }
 
 void RAMS7200LibFacade::Connect()
 {
     Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__, "Snap7: Connecting to : Local TSAP Port : Remote TSAP Port'", (ms._ip + " : "+ std::to_string(Common::Constants::getLocalTsapPort()) + ":" + std::to_string(Common::Constants::getRemoteTsapPort())).c_str());
 
-    _client.reset(new TS7Client());
+    // The client is kept between attempts
+    if(!_client) {
+        _client.reset(new TS7Client());
+    }
 
     _client->SetConnectionParams(ms._ip.c_str(), Common::Constants::getLocalTsapPort(), Common::Constants::getRemoteTsapPort());
     if(_client->Connect() == 0 && _client->Connected()) {
         Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__, "Snap7: Connected to '", ms._ip.c_str());
         _wasConnected = true;
         ioFailures = 0;
+        const auto pduSize = _client->PDULength();
+        Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__, ("Snap7: Negotiated PDU length " + std::to_string(pduSize) + " bytes with PLC IP:").c_str(), ms._ip.c_str());
+        // A new connection starts again from the configured item limit, which may have been reduced on the previous one
+        if(pduSize > static_cast<int>(OVERHEAD_WRITE_MESSAGE + OVERHEAD_WRITE_VARIABLE)) {
+            setConnectionLimits(pduSize, Common::Constants::getMaxItemsPerRequest());
+        } else {
+            setConnectionLimits(_pduSize, Common::Constants::getMaxItemsPerRequest());
+        }
     }
 }
 
@@ -80,72 +148,108 @@ void RAMS7200LibFacade::Disconnect()
 }
 
 
+void RAMS7200LibFacade::RefreshReadPlan()
+{
+    std::lock_guard lock{ms._rwmutex};
+    if(!ms._readPlan.isDirty()) {
+        return;
+    }
+    // One walk over the poll time column for all the groups to rebuild; a location is read at the fastest poll time of its subscribers
+    std::map<std::chrono::milliseconds, std::vector<RAMS7200ReadPlanEntry>> entries;
+    for(const auto pollTime : ms._readPlan.dirtyPollTimes()) {
+        entries[pollTime];
+    }
+    for(RAMS7200TagId id = 0; id < ms._tags.slots(); ++id) {
+        auto it = entries.find(ms._tags.pollTime(id));
+        if(it != entries.end() && ms._tags.isUsed(id)) {
+            const auto& subscribers = ms._tags.subscribers(id);
+            it->second.emplace_back(RAMS7200ReadPlanEntry{subscribers.front(), subscribers});
+        }
+    }
+    for(auto& [pollTime, groupEntries] : entries) {
+        ms._readPlan.rebuild(pollTime, std::move(groupEntries), Common::Constants::getCoalesceGap(), _pduSize, _maxItems, OVERHEAD_READ_VARIABLE, OVERHEAD_READ_MESSAGE);
+    }
+}
+
 void RAMS7200LibFacade::Poll()
 {
     if(!_wasConnected){
         Common::Logger::globalWarning(__PRETTY_FUNCTION__, "Not connected to PLC IP:", ms._ip.c_str());
         return;
     }
-    if(ms.vars.empty()){
+    if(ms.isEmpty()){
         Common::Logger::globalWarning(__PRETTY_FUNCTION__, "No addresses for PLC IP:", ms._ip.c_str());
         return;
     }
-    auto pollStartTime = std::chrono::steady_clock::now();
+    RefreshReadPlan();
+
     Common::Logger::globalInfo(Common::Logger::L3,__PRETTY_FUNCTION__, ms._ip.c_str());
-    std::vector<DPInfo> addressesToPoll;
-    std::vector<TS7DataItem> items;
-    const auto pollInterval = Common::Constants::getPollingInterval();
-    {
-        std::lock_guard lock{ms._rwmutex};
-        for(auto& [_, var] : ms.vars) {
-            const auto fpollTime = var.pollTime > pollInterval ? var.pollTime : pollInterval;
-            const auto tDiff =  std::chrono::duration_cast<std::chrono::seconds>(pollStartTime - var.lastPollTime).count();
-            if(tDiff >= fpollTime) {
-                var.lastPollTime = std::chrono::steady_clock::now();
-                addressesToPoll.emplace_back(DPInfo{
-                    dpAddress: ms._ip + "$" + var.varName + "$" + std::to_string(var.pollTime),
-                    plcAddress: var.varName,
-                    dpSize: Common::S7Utils::GetByteSizeFromAddress(var.varName),
-                });
-                items.emplace_back(Common::S7Utils::TS7DataItemShallowClone(var._toDP));
-            }
+    ms._readPlan.popDue(std::chrono::steady_clock::now(), _dueGroups);
+    for(auto group : _dueGroups) {
+        for(auto& range : group->ranges) {
+            range.Result = -1;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        RAMS7200ExecuteBatches(group->ranges, group->batches, Common::S7Utils::Operation::READ);
+        const auto readDone = std::chrono::steady_clock::now();
+        const auto acquired = std::chrono::system_clock::now();
+        _readRttMetric.record(std::chrono::duration_cast<std::chrono::microseconds>(readDone - start));
+        if(Common::Constants::getSmoothing() || group->filtered) {
+            doSmoothing(*group, acquired, readDone);
+        } else {
+            queueAll(*group, acquired, readDone);
         }
     }
-    if(!addressesToPoll.empty()) {
-        RAMS7200ReadWriteMaxN(addressesToPoll, items, 19, PDU_SIZE, OVERHEAD_READ_VARIABLE, OVERHEAD_READ_MESSAGE, Common::S7Utils::Operation::READ);
-    }
-    else
+    if(_dueGroups.empty())
     {
         Common::Logger::globalInfo(Common::Logger::L3, "No vars to poll at the moment");
     }
 
 }
 
+std::chrono::steady_clock::time_point RAMS7200LibFacade::NextDeadline()
+{
+    RefreshReadPlan();
+    return ms._readPlan.nextDeadline();
+}
+
 void RAMS7200LibFacade::WriteToPLC() {
     if(!_wasConnected){
         Common::Logger::globalWarning(__PRETTY_FUNCTION__, "Not connected to PLC IP:", ms._ip.c_str());
         return;
     }
-    std::vector<DPInfo> addresses;
+    const bool confirm = Common::Constants::getWriteConfirmation();
     std::vector<TS7DataItem> items;
+    std::vector<RAMS7200WriteTarget> targets;
     {
         std::lock_guard lock{ms._rwmutex};
-        for(auto& [_, var] : ms.vars) {
-            if(var._toPlc.pdata != nullptr){
-                addresses.emplace_back(DPInfo{
-                    dpAddress: ms._ip + "$" + var.varName + "$" + std::to_string(var.pollTime),
-                    plcAddress: var.varName,
-                    dpSize: Common::S7Utils::GetByteSizeFromAddress(var.varName),
-                });
-                items.emplace_back(var._toPlc);
-                var._toPlc.pdata = nullptr;
+        ms._writePending = false;
+        ms._tags.takeWrites([&](RAMS7200TagId id, void* data){
+            auto item = ms._tags.subscribers(id).front()->item;
+            item.pdata = data;
+            items.emplace_back(item);
+            if(confirm) {
+                targets.emplace_back(RAMS7200WriteTarget{ms._tags.subscribers(id), ms._tags.pollTime(id)});
+            } else {
                 // Make sure that the next poll will happen immediately
-                var.lastPollTime -= std::chrono::seconds(std::max(var.pollTime, Common::Constants::getPollingInterval()));
+                ms._readPlan.forcePoll(ms._tags.pollTime(id));
             }
-        }
+        });
     }
-    if(!addresses.empty()){
-        RAMS7200ReadWriteMaxN(addresses, items, 19, PDU_SIZE, OVERHEAD_WRITE_VARIABLE, OVERHEAD_WRITE_MESSAGE, Common::S7Utils::Operation::WRITE);
+    if(!items.empty()){
+        // Consecutive addresses (e.g. a recipe of VW words) are written as a single range
+        std::vector<std::vector<size_t>> rangeMembers;
+        auto ranges = Common::S7Coalescer::CoalesceWrites(items, rangeMembers, _pduSize - OVERHEAD_WRITE_MESSAGE - OVERHEAD_WRITE_VARIABLE - 1);
+        Common::Logger::globalInfo(Common::Logger::L3, __PRETTY_FUNCTION__, ("Writing " + std::to_string(items.size()) + " items as " + std::to_string(ranges.size()) + " ranges to PLC IP:").c_str(), ms._ip.c_str());
+        const auto start = std::chrono::steady_clock::now();
+        RAMS7200ReadWriteMaxN(ranges, OVERHEAD_WRITE_VARIABLE, OVERHEAD_WRITE_MESSAGE, Common::S7Utils::Operation::WRITE);
+        if(confirm) {
+            ConfirmWrites(items, targets, ranges, rangeMembers, start);
+        }
+        Common::S7Coalescer::FreeWriteRanges(ranges, rangeMembers);
+        std::for_each(items.begin(), items.end(), [](TS7DataItem& item){
+            Common::S7Utils::TS7DeallocateDataItem(item);
+        });
     }
     else
     {
@@ -153,156 +257,321 @@ void RAMS7200LibFacade::WriteToPLC() {
     }
 }
 
+void RAMS7200LibFacade::ConfirmWrites(const std::vector<TS7DataItem>& items, const std::vector<RAMS7200WriteTarget>& targets, const std::vector<TS7DataItem>& ranges,
+    const std::vector<std::vector<size_t>>& rangeMembers, std::chrono::steady_clock::time_point start)
+{
+    // Read back exactly the ranges that were written, into a buffer of their own
+    std::vector<TS7DataItem> readBack;
+    std::vector<size_t> readBackRanges;
+    std::vector<size_t> offsets;
+    size_t bufferSize = 0;
+    for(size_t r = 0; r < ranges.size(); ++r) {
+        if(ranges[r].Result == 0) {
+            readBack.emplace_back(ranges[r]);
+            readBackRanges.push_back(r);
+            offsets.push_back(bufferSize);
+            bufferSize += Common::S7Coalescer::ByteSize(ranges[r]);
+        }
+    }
+    std::vector<char> buffer(bufferSize);
+    for(size_t i = 0; i < readBack.size(); ++i) {
+        readBack[i].pdata = buffer.data() + offsets[i];
+        readBack[i].Result = -1;
+    }
+    if(!readBack.empty()) {
+        RAMS7200ReadWriteMaxN(readBack, OVERHEAD_READ_VARIABLE, OVERHEAD_READ_MESSAGE, Common::S7Utils::Operation::READ);
+    }
+    const auto readDone = std::chrono::steady_clock::now();
+    const auto acquired = std::chrono::system_clock::now();
+
+    std::vector<Common::BufferPool::Slice> confirmed(items.size());
+    std::vector<toDPTriple> toDPItems;
+    Common::BufferPool::Arena arena(std::accumulate(items.begin(), items.end(), size_t{0}, [](size_t sum, const TS7DataItem& item){
+        return sum + Common::S7Coalescer::ByteSize(item);
+    }));
+    for(size_t i = 0; i < readBack.size(); ++i) {
+        if(readBack[i].Result != 0) {
+            continue;
+        }
+        const auto& range = ranges[readBackRanges[i]];
+        for(const auto idx : rangeMembers[readBackRanges[i]]) {
+            const auto size = Common::S7Coalescer::ByteSize(items[idx]);
+            auto value = arena.allocate(size);
+            std::memcpy(value.data(), buffer.data() + offsets[i] + (items[idx].Start - range.Start), size);
+            for(const auto& subscriber : targets[idx].subscribers) {
+                toDPItems.emplace_back(subscriber, size, value);
+            }
+            confirmed[idx] = value;
+        }
+    }
+    _queueToDPCB(RAMS7200ToDPBatch(std::move(toDPItems), acquired, readDone));
+    _writeConfirmLatencyMetric.record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start));
+
+    // What could not be confirmed is polled again with its group
+    std::lock_guard lock{ms._rwmutex};
+    std::map<std::chrono::milliseconds, std::unordered_map<uint64_t, size_t>> confirmedLocations;
+    for(size_t idx = 0; idx < items.size(); ++idx) {
+        if(confirmed[idx].data() == nullptr) {
+            ms._readPlan.forcePoll(targets[idx].pollTime);
+        } else {
+            confirmedLocations[targets[idx].pollTime].emplace(targets[idx].subscribers.front()->address.packed(), idx);
+        }
+    }
+    // What was confirmed is both the last value read and the last value sent: the next poll does not publish it again
+    const auto now = std::chrono::steady_clock::now();
+    for(const auto& [pollTime, locations] : confirmedLocations) {
+        auto groupIt = ms._readPlan.groups().find(pollTime);
+        if(groupIt == ms._readPlan.groups().end()) {
+            continue;
+        }
+        auto& group = groupIt->second;
+        for(auto& member : group.members) {
+            const auto location = locations.find(member.tag->address.packed());
+            if(location == locations.end()) {
+                continue;
+            }
+            const auto& target = targets[location->second];
+            const char* value = confirmed[location->second].data();
+            member.store(value, group.previous.data());
+            for(auto& subscriber : member.subscribers) {
+                if(std::find(target.subscribers.begin(), target.subscribers.end(), subscriber.tag) != target.subscribers.end()) {
+                    std::memcpy(group.sent.data() + subscriber.sent, value, member.size);
+                    subscriber.lastSent = now;
+                    subscriber.initialized = true;
+                }
+            }
+        }
+    }
+}
 
 void RAMS7200LibFacade::RAMS7200MarkDeviceConnectionError(bool error_status){
+    // Only sent when it changes, and refreshed from time to time
+    const auto now = std::chrono::steady_clock::now();
+    if(_errorStatus == static_cast<int>(error_status) && now - _errorStatusSent < ERROR_STATUS_REFRESH) {
+        return;
+    }
+    _errorStatus = error_status;
+    _errorStatusSent = now;
     Common::Logger::globalInfo(Common::Logger::L3,__PRETTY_FUNCTION__, std::to_string(error_status).c_str(), CharString("PLC IP: ") + CharString(ms._ip.c_str())) ;
-    auto pdata = new char[sizeof(bool)];
-    memcpy(pdata, &error_status , sizeof(bool));
-    this->_queueToDPCB({std::make_tuple(ms._ip + "._system$_Error",sizeof(bool), pdata)});
+    this->_queueToDPCB(RAMS7200ToDPBatch({std::make_tuple(_errorTag, sizeof(bool), Common::BufferPool::Slice::copyOf(&error_status, sizeof(bool)))}));
 }
 
-void RAMS7200LibFacade::RAMS7200ReadWriteMaxN(std::vector<DPInfo> dpItems, std::vector<TS7DataItem> items, const uint N, const uint PDU_SZ, const uint VAR_OH, const uint MSG_OH, const Common::S7Utils::Operation rorw) {
-    try{
+void RAMS7200LibFacade::setConnectionLimits(uint pduSize, uint maxItems)
+{
+    if(pduSize == _pduSize && maxItems == _maxItems) {
+        return;
+    }
+    Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__, ("PDU length " + std::to_string(pduSize) + " bytes, max " + std::to_string(maxItems) + " items per request for PLC IP:").c_str(), ms._ip.c_str());
+    _pduSize = pduSize;
+    _maxItems = maxItems;
+    std::lock_guard lock{ms._rwmutex};
+    ms._readPlan.invalidateAll();
+}
 
-        int retOpt;
-        auto curr_sum = 0;
-        uint last_index = 0;
-        uint to_send = 0;
-        while(last_index < items.size()) {
-            if(ioFailures >= Common::Constants::getMaxIoFailures()) {
-                Common::Logger::globalWarning(__PRETTY_FUNCTION__, "Max IO Failures reached for PLC IP:", ms._ip.c_str());
-                break;
+void RAMS7200LibFacade::RAMS7200ReadWriteMaxN(std::vector<TS7DataItem>& items, const uint VAR_OH, const uint MSG_OH, const Common::S7Utils::Operation rorw) {
+    const auto maxItems = _maxItems;
+    RAMS7200ExecuteBatches(items, Common::S7Coalescer::Pack(items, _maxItems, _pduSize, VAR_OH, MSG_OH), rorw);
+
+    if(_maxItems < maxItems) {
+        // The PLC rejected a request with too many items: send again what was rejected (not what failed), packed with the new limit
+        std::vector<TS7DataItem> rejected;
+        std::vector<size_t> indexes;
+        for(size_t i = 0; i < items.size(); ++i) {
+            if(isRejected(items[i].Result)) {
+                rejected.emplace_back(items[i]);
+                indexes.push_back(i);
             }
-            to_send = 0;
-            curr_sum = 0;
-            
-            for (auto it = items.begin() + last_index; it != items.end(); ++it) {
-                const auto& var = *it;
-                const auto dataSize = Common::S7Utils::DataSizeByte(var.WordLen) * var.Amount;
-                const auto itemSize = dataSize + VAR_OH;
-                if (curr_sum + itemSize < PDU_SZ - MSG_OH && to_send < N) {
-                    curr_sum += itemSize;
-                    ++to_send;
-                } else {
-                    break;
-                }
-            }
-
-            if(to_send == 0) {
-                //This means that the current variable has a mem size > PDU. Call with ReadArea because it can split the request automatically (PDU Independance)
-                to_send += 1;
-                const auto& last_item = items[last_index];
-                curr_sum = ((Common::S7Utils::DataSizeByte(last_item.WordLen)) * last_item.Amount) + VAR_OH + MSG_OH;
-
-                if(rorw == Common::S7Utils::Operation::READ)
-                    retOpt = _client->ReadArea(last_item.Area, last_item.DBNumber, last_item.Start, last_item.Amount, last_item.WordLen, last_item.pdata);
-                else
-                    retOpt = _client->WriteArea(last_item.Area, last_item.DBNumber, last_item.Start, last_item.Amount, last_item.WordLen, last_item.pdata);
+        }
+        RAMS7200ExecuteBatches(rejected, Common::S7Coalescer::Pack(rejected, _maxItems, _pduSize, VAR_OH, MSG_OH), rorw);
+        // pdata is shared with the copies, only the results have to be given back
+        for(size_t i = 0; i < rejected.size(); ++i) {
+            items[indexes[i]].Result = rejected[i].Result;
+        }
+    }
+}
 
-            } else {
-                if(rorw == Common::S7Utils::Operation::READ)
-                    retOpt = _client->ReadMultiVars(&(items[last_index]), to_send);
-                else {
-                    retOpt = _client->WriteMultiVars(&(items[last_index]), to_send);
-                }
+void RAMS7200LibFacade::RAMS7200ExecuteBatches(std::vector<TS7DataItem>& items, const std::vector<Common::S7Coalescer::Batch>& batches, const Common::S7Utils::Operation rorw) {
+    try{
+        // Writes stay on the main connection, so that they reach the PLC in order
+        if(rorw == Common::S7Utils::Operation::READ && batches.size() > 1) {
+            _readySessions.clear();
+            for(auto& session : _sessions) {
+                if(session->available())
+                    _readySessions.push_back(session.get());
             }
-           
-            if( retOpt != 0) {
-                ++ioFailures;
-                for(auto i = last_index; i < last_index + to_send; i++) {
-                    items[i].Result = retOpt;
-                }
-                std::stringstream ss;
-                ss << ms._ip << (rorw == Common::S7Utils::Operation::READ ? "Read" : "Write");
-                ss << " KO for PLC IP:" << ms._ip << " with " << to_send << " items and PDU size of " << curr_sum + MSG_OH << " bytes , ioFailures: " << ioFailures;
-                Common::Logger::globalWarning(ss.str().c_str());
+            if(_readySessions.size() > 1) {
+                RAMS7200ExecuteBatchesPipelined(items, batches, rorw);
+                return;
             }
-            last_index += to_send;
         }
-        if(rorw == Common::S7Utils::Operation::READ) {
-            if(Common::Constants::getSmoothing()) {
-                doSmoothing(std::move(dpItems), std::move(items));
-            } else {
-                queueAll(std::move(dpItems), std::move(items));
+
+        for(const auto& batch : batches) {
+            if(ioFailures >= Common::Constants::getMaxIoFailures()) {
+                Common::Logger::globalWarning(__PRETTY_FUNCTION__, "Max IO Failures reached for PLC IP:", ms._ip.c_str());
+                break;
             }
-        } else {
-            std::for_each(items.begin(), items.end(), [](TS7DataItem& item){
-               Common::S7Utils::TS7DeallocateDataItem(item);
-            });
+            const auto retOpt = Common::S7Utils::TransferItems(*_client, &(items[batch.first]), batch.count, batch.split, rorw);
+            handleBatchResult(items, batch, retOpt, rorw);
         }
-
     }
     catch(std::exception& e){
         Common::Logger::globalWarning(__PRETTY_FUNCTION__," Encountered Exception:", e.what());
     }
 }
 
-void RAMS7200LibFacade::queueAll(std::vector<DPInfo>&& dpItems, std::vector<TS7DataItem>&& s7items){
+void RAMS7200LibFacade::RAMS7200ExecuteBatchesPipelined(std::vector<TS7DataItem>& items, const std::vector<Common::S7Coalescer::Batch>& batches, const Common::S7Utils::Operation rorw) {
+    // Batch i goes to ready session i % depth: with at most depth batches in flight, its session is done with batch i - depth.
+    // Results are collected in submission order; each batch reads into its own part of the buffer.
+    const auto depth = _readySessions.size();
+    size_t submitted = 0;
+    size_t collected = 0;
+    while(collected < batches.size()) {
+        if(submitted < batches.size() && submitted - collected < depth && ioFailures < Common::Constants::getMaxIoFailures()) {
+            const auto& batch = batches[submitted];
+            _readySessions[submitted % depth]->submit(&(items[batch.first]), batch.count, batch.split, rorw);
+            ++submitted;
+        } else if(collected < submitted) {
+            const auto& batch = batches[collected];
+            auto retOpt = _readySessions[collected % depth]->wait();
+            if(retOpt == ERR_SESSION_NOT_CONNECTED) {
+                // The session lost its connection, not the PLC: the batch goes over the main connection
+                retOpt = Common::S7Utils::TransferItems(*_client, &(items[batch.first]), batch.count, batch.split, rorw);
+            }
+            handleBatchResult(items, batch, retOpt, rorw);
+            ++collected;
+        } else {
+            Common::Logger::globalWarning(__PRETTY_FUNCTION__, "Max IO Failures reached for PLC IP:", ms._ip.c_str());
+            break;
+        }
+    }
+}
 
-    std::vector<toDPTriple> toDPItems;
-    toDPItems.reserve(s7items.size());
+void RAMS7200LibFacade::handleBatchResult(std::vector<TS7DataItem>& items, const Common::S7Coalescer::Batch& batch, int retOpt, const Common::S7Utils::Operation rorw) {
+    if(retOpt != 0 && batch.count > 1 && isRejected(retOpt)) {
+        // Not an IO failure: the PLC does not accept that many items in one request
+        for(auto i = batch.first; i < batch.first + batch.count; i++) {
+            items[i].Result = retOpt;
+        }
+        Common::Logger::globalWarning(__PRETTY_FUNCTION__, ("Request with " + std::to_string(batch.count) + " items rejected by PLC IP:").c_str(), ms._ip.c_str());
+        setConnectionLimits(_pduSize, std::min<uint>(_maxItems, batch.count / 2));
+        return;
+    }
 
-    std::stringstream failed;
+    if( retOpt != 0) {
+        ++ioFailures;
+        for(auto i = batch.first; i < batch.first + batch.count; i++) {
+            items[i].Result = retOpt;
+        }
+        std::stringstream ss;
+        ss << ms._ip << (rorw == Common::S7Utils::Operation::READ ? "Read" : "Write");
+        ss << " KO for PLC IP:" << ms._ip << " with " << batch.count << " items and PDU size of " << batch.bytes << " bytes , ioFailures: " << ioFailures;
+        Common::Logger::globalWarning(ss.str().c_str());
+    }
+}
 
-    for(uint i = 0; i < s7items.size(); i++) {
-        if(s7items[i].Result == 0) {
-            Common::Logger::globalInfo(Common::Logger::L4, dpItems[i].dpAddress.c_str(), Common::S7Utils::DisplayTS7DataItem(&s7items[i], Common::S7Utils::Operation::READ).c_str());
-            toDPItems.emplace_back(dpItems[i].dpAddress.c_str(), dpItems[i].dpSize, static_cast<char*>(s7items[i].pdata));
+void RAMS7200LibFacade::queueAll(RAMS7200ReadGroup& group, std::chrono::system_clock::time_point acquired, std::chrono::steady_clock::time_point readDone){
+
+    std::vector<toDPTriple> toDPItems;
+    toDPItems.reserve(group.members.size());
+
+    std::string failed;     // only allocated when a read failed
+    // All the values of the cycle share one pooled chunk
+    Common::BufferPool::Arena arena(group.valuesSize);
+
+    const auto now = std::chrono::steady_clock::now();
+    for(auto& member : group.members) {
+        if(group.ranges[member.range].Result == 0) {
+            // Read once, fanned out to each subscriber at its own period
+            Common::BufferPool::Slice value;
+            for(auto& subscriber : member.subscribers) {
+                if(!subscriber.takes(group.period, now)) {
+                    continue;
+                }
+                if(value.data() == nullptr) {
+                    value = arena.allocate(member.size);
+                    member.extract(group.buffer.data(), value.data());
+                    logValue(member, value.data());
+                }
+                toDPItems.emplace_back(subscriber.tag, member.size, value);
+            }
         } else {
-            failed <<  dpItems[i].dpAddress.c_str() << " ";
-            Common::S7Utils::TS7DeallocateDataItem(s7items[i]);
+            failed.append(member.tag->dpAddress.c_str()).append(" ");
         }
     }
 
-    if (!failed.str().empty()) {
-        Common::Logger::globalWarning("Failed for: ", failed.str().c_str());
+    if (!failed.empty()) {
+        Common::Logger::globalWarning("Failed for: ", failed.c_str());
     }
 
-    _queueToDPCB(std::move(toDPItems));
+    _queueToDPCB(RAMS7200ToDPBatch(std::move(toDPItems), acquired, readDone));
 }
 
-void RAMS7200LibFacade::doSmoothing(std::vector<DPInfo>&& dpItems, std::vector<TS7DataItem>&& s7items){
+void RAMS7200LibFacade::doSmoothing(RAMS7200ReadGroup& group, std::chrono::system_clock::time_point acquired, std::chrono::steady_clock::time_point readDone){
     
     std::vector<toDPTriple> toDPItems;
-    toDPItems.reserve(s7items.size());
-
-    std::stringstream failed;
-
-    {
-        std::lock_guard lock(ms._rwmutex);
-
-        for(uint i = 0; i < s7items.size(); i++) {
-            auto& item = s7items[i];
-            if(item.Result == 0 && item.pdata != nullptr) {
-                const auto& DPInfo = dpItems[i];
-                Common::Logger::globalInfo(Common::Logger::L4, DPInfo.dpAddress.c_str(), Common::S7Utils::DisplayTS7DataItem(&item, Common::S7Utils::Operation::READ).c_str());
-                auto it = ms.vars.find(DPInfo.plcAddress);
-                if(it != ms.vars.end()) {
-                    auto& var = it->second;
-                    const auto dataSize = var._toDP.Amount * Common::S7Utils::DataSizeByte(var._toDP.WordLen);
-                    if(var._toDP.pdata == nullptr) {
-                        Common::S7Utils::TS7AllocateDataItemForAddress(var._toDP);
-                        std::memcpy(var._toDP.pdata, item.pdata, dataSize);
-                        toDPItems.emplace_back(DPInfo.dpAddress.c_str(), dataSize, static_cast<char*>(item.pdata));
-                        Common::Logger::globalInfo(Common::Logger::L4, DPInfo.dpAddress.c_str(), "--> Smoothing initialized");
-                    } else if (std::memcmp(var._toDP.pdata, item.pdata, dataSize) != 0) {
-                        std::memcpy(var._toDP.pdata, item.pdata, dataSize);
-                        toDPItems.emplace_back(DPInfo.dpAddress.c_str(), dataSize, static_cast<char*>(item.pdata));
-                        Common::Logger::globalInfo(Common::Logger::L4, DPInfo.dpAddress.c_str(), "--> Smoothing updated");
-                    } else {
-                        Common::S7Utils::TS7DeallocateDataItem(item);
+    toDPItems.reserve(group.members.size());
+
+    std::string failed;     // only allocated when a read failed
+    // All the values of the cycle share one pooled chunk
+    Common::BufferPool::Arena arena(group.valuesSize);
+
+    // One pass over the whole group buffer, then only the members in changed blocks are compared
+    Common::ChangeDetector::Compare(group.buffer.data(), group.previous.data(), group.buffer.size(), group.dirty);
+
+    const auto now = std::chrono::steady_clock::now();
+    const bool smoothing = Common::Constants::getSmoothing();
+    for(auto& member : group.members) {
+        if(group.ranges[member.range].Result == 0) {
+            const bool changed = Common::ChangeDetector::IsDirty(group.dirty, member.offset, member.size) && member.differs(group.buffer.data(), group.previous.data());
+            Common::BufferPool::Slice value;
+            for(auto& subscriber : member.subscribers) {
+                if(!subscriber.takes(group.period, now)) {
+                    continue;
+                }
+                const auto& tag = *subscriber.tag;
+                // Value last sent to this subscriber, so that a value slowly drifting inside the deadband is eventually sent
+                char* sent = group.sent.data() + subscriber.sent;
+                bool send = !subscriber.initialized || (!smoothing && !tag.filter.isSet());
+                // A subscriber slower than the group may have missed changes since its last value
+                if(!send && (changed || subscriber.period > group.period) && member.differsFrom(group.buffer.data(), sent)) {
+                    // Bits have no deadband
+                    send = member.bit >= 0 || tag.exceedsDeadband(group.buffer.data() + member.offset, sent);
+                }
+                const auto maxAge = tag.filter.maxAge.count() > 0 ? tag.filter.maxAge : Common::Constants::getMaxAge();
+                if(!send && maxAge.count() > 0 && now - subscriber.lastSent >= maxAge) {
+                    send = true;
+                }
+                if(send) {
+                    member.extract(group.buffer.data(), sent);
+                    subscriber.lastSent = now;
+                    if(value.data() == nullptr) {
+                        value = arena.allocate(member.size);
+                        member.extract(group.buffer.data(), value.data());
+                        logValue(member, value.data());
                     }
+                    toDPItems.emplace_back(subscriber.tag, member.size, value);
+                    Common::Logger::globalInfo(Common::Logger::L4, tag.dpAddress, subscriber.initialized ? "--> Smoothing updated" : "--> Smoothing initialized");
+                    subscriber.initialized = true;
                 }
-            } else {
-                failed << dpItems[i].dpAddress.c_str() << " ";
-                Common::S7Utils::TS7DeallocateDataItem(item);
             }
-            item.pdata = nullptr;
+        } else {
+            failed.append(member.tag->dpAddress.c_str()).append(" ");
         }
     }
+    // previous mirrors the last read, the next pass only looks at what changed since
+    std::copy(group.buffer.begin(), group.buffer.end(), group.previous.begin());
 
-    if (!failed.str().empty()) {
-        Common::Logger::globalWarning("Failed for: ", failed.str().c_str());
+    if (!failed.empty()) {
+        Common::Logger::globalWarning("Failed for: ", failed.c_str());
     }
-    _queueToDPCB(std::move(toDPItems));
-}
\ No newline at end of file
+    _queueToDPCB(RAMS7200ToDPBatch(std::move(toDPItems), acquired, readDone));
+}
+
+void RAMS7200LibFacade::logValue(const RAMS7200ReadMember& member, char* pdata)
+{
+    if(Common::Logger::getLogLevel() >= Common::Logger::L4) {
+        TS7DataItem item = member.tag->item;
+        item.pdata = pdata;
+        Common::Logger::globalInfo(Common::Logger::L4, member.tag->dpAddress, Common::S7Utils::DisplayTS7DataItem(&item, Common::S7Utils::Operation::READ).c_str());
+    }
+}
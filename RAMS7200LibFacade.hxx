@@ -19,7 +19,8 @@
 #define OVERHEAD_READ_VARIABLE 5
 #define OVERHEAD_WRITE_MESSAGE 24
 #define OVERHEAD_WRITE_VARIABLE 16
-#define PDU_SIZE 240
+#define PDU_SIZE 240                            // used until a PDU length is negotiated
+#define ERROR_STATUS_REFRESH std::chrono::seconds(30)   // the connection status is sent again after this long even if unchanged
 
 #include <string>
 #include <chrono>
@@ -38,9 +39,19 @@
 #include <thread>
 
 #include "RAMS7200MS.hxx"
+#include "RAMS7200AsyncSession.hxx"
+#include "RAMS7200ReconnectPolicy.hxx"
 #include "Common/Logger.hxx"
+#include "Common/Metrics.hxx"
 
 
+// A location written to the PLC, with the subscribers getting the confirmed value (writeConfirmation)
+struct RAMS7200WriteTarget
+{
+    std::vector<RAMS7200TagHandle> subscribers;
+    std::chrono::milliseconds pollTime;         // of the location, to poll it again if the write cannot be confirmed
+};
+
 /**
  * @brief The RAMS7200LibFacade class is a facade and encompasses all the consumer interaction with snap7
  */
@@ -62,9 +73,20 @@ public:
     RAMS7200LibFacade& operator=(RAMS7200LibFacade&&) = delete;
     ~RAMS7200LibFacade() = default;
 
+    /**
+     * @brief One iteration of the PLC loop: checks the connection, then sends the pending writes and reads the groups that are due
+     * @return the time at which the PLC needs attention again, unless a write is queued before
+     */
+    std::chrono::steady_clock::time_point RunOnce();
+
     void Poll();
     void WriteToPLC();
-    void EnsureConnection();
+    // Time at which the next group of variables is due
+    std::chrono::steady_clock::time_point NextDeadline();
+    // Single connection attempt if not connected and the reconnect policy allows it, returns whether the PLC is connected
+    bool EnsureConnection();
+    // Whether the last iteration left the PLC connected; otherwise the next one may block on a connection attempt
+    bool IsConnected() const { return _wasConnected; }
 
     void Connect();
 
@@ -77,13 +99,34 @@ public:
         });
     }
 
+    // Sleeps until the deadline, or until a write is queued for the PLC while writes can be sent
+    template <typename T>
+    void sleep_until(T deadline)
+    {
+        std::unique_lock<std::mutex> lk(ms._threadMutex);
+        ms._threadCv.wait_until(lk, deadline, [&](){
+           return !ms._run.load() || (_writesEnabled && ms._writePending.load());
+        });
+    }
+
 private:
     void Reconnect();
     void Disconnect();
     void RAMS7200MarkDeviceConnectionError(bool);
-    void RAMS7200ReadWriteMaxN(std::vector<DPInfo> dpItems, std::vector<TS7DataItem> items, const uint N, const uint PDU_SZ, const uint VAR_OH, const uint MSG_OH, const Common::S7Utils::Operation rorw);
-    void doSmoothing(std::vector<DPInfo>&& dpItems, std::vector<TS7DataItem>&& items);
-    void queueAll(std::vector<DPInfo>&& dpItems, std::vector<TS7DataItem>&& items);
+    void RefreshReadPlan();
+    // Reads back the written ranges in as few requests as possible and publishes the confirmed values (writeConfirmation)
+    void ConfirmWrites(const std::vector<TS7DataItem>& items, const std::vector<RAMS7200WriteTarget>& targets, const std::vector<TS7DataItem>& ranges,
+        const std::vector<std::vector<size_t>>& rangeMembers, std::chrono::steady_clock::time_point start);
+    void RAMS7200ReadWriteMaxN(std::vector<TS7DataItem>& items, const uint VAR_OH, const uint MSG_OH, const Common::S7Utils::Operation rorw);
+    void RAMS7200ExecuteBatches(std::vector<TS7DataItem>& items, const std::vector<Common::S7Coalescer::Batch>& batches, const Common::S7Utils::Operation rorw);
+    void RAMS7200ExecuteBatchesPipelined(std::vector<TS7DataItem>& items, const std::vector<Common::S7Coalescer::Batch>& batches, const Common::S7Utils::Operation rorw);
+    // Whether a request was rejected for having too many items, rather than failed
+    static bool isRejected(int result) { return result == static_cast<int>(errCliTooManyItems); }
+    void handleBatchResult(std::vector<TS7DataItem>& items, const Common::S7Coalescer::Batch& batch, int retOpt, const Common::S7Utils::Operation rorw);
+    void doSmoothing(RAMS7200ReadGroup& group, std::chrono::system_clock::time_point acquired, std::chrono::steady_clock::time_point readDone);
+    void queueAll(RAMS7200ReadGroup& group, std::chrono::system_clock::time_point acquired, std::chrono::steady_clock::time_point readDone);
+    void logValue(const RAMS7200ReadMember& member, char* pdata);
+    void setConnectionLimits(uint pduSize, uint maxItems);
 
     uint32_t ioFailures{0};
     RAMS7200MS& ms;
@@ -91,7 +134,23 @@ private:
     // S7 related
     queueToDPCallback _queueToDPCB;
     bool _wasConnected{false};
+    bool _writesEnabled{false};     // connected and active (redundancy): a queued write is sent right away
+    const RAMS7200TagHandle _errorTag;
+    // Per PLC metrics, resolved once
+    Common::Metrics::Histogram& _readRttMetric;
+    Common::Metrics::Histogram& _writeConfirmLatencyMetric;
+    Common::Metrics::Counter& _connectFailuresMetric;
+    int _errorStatus{-1};   // last connection status sent to WinCC OA, -1 if none
+    std::chrono::steady_clock::time_point _errorStatusSent{};
+    RAMS7200ReconnectPolicy _reconnect;
     std::unique_ptr<TS7Client> _client{nullptr};
+    std::vector<RAMS7200ReadGroup*> _dueGroups;
+    // Negotiated PDU length, and max number of items per multi-var request accepted by the PLC (lowered if it rejects a request)
+    uint _pduSize{PDU_SIZE};
+    uint _maxItems{Common::Constants::getMaxItemsPerRequest()};
+    // Extra sessions keeping several requests in flight (pipelineDepth > 1)
+    std::vector<std::unique_ptr<RAMS7200AsyncSession>> _sessions;
+    std::vector<RAMS7200AsyncSession*> _readySessions;     // sessions connected at the start of the current batches
 };
 
 #endif //RAMS7200LIBFACADE_HXX
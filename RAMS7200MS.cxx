@@ -15,44 +15,88 @@
 #include "RAMS7200MS.hxx"
 #include "Common/S7Utils.hxx"
 #include "Common/Logger.hxx"
+#include "Common/Utils.hxx"
 #include <algorithm>
 
 
-RAMS7200MSVar::RAMS7200MSVar(std::string varName, int pollTime, TS7DataItem type) : varName(varName), pollTime(pollTime), _toPlc(type), _toDP(type){
-    _toPlc.pdata = nullptr;
-    _toDP.pdata = nullptr;
+void RAMS7200MS::addVar(std::string varName, const std::string& pollTime, const std::string& options, RAMS7200ValueType valueType, HWObject* hwObject)
+{
+    std::lock_guard lock{_rwmutex};
+    auto tag = RAMS7200Tag::make(_ip, varName, pollTime, options, valueType);
+    tag->attach(hwObject);
+    subscribe(std::move(tag));
 }
 
-void RAMS7200MS::addVar(std::string varName, int pollTime)
+void RAMS7200MS::addVars(const std::vector<RAMS7200MSVarConfig>& configs)
 {
     std::lock_guard lock{_rwmutex};
-    auto var = RAMS7200MSVar(varName, pollTime, Common::S7Utils::TS7DataItemFromAddress(varName, false));
-    vars.emplace(varName, std::move(var));
+    _tags.reserve(_tags.size() + configs.size());
+    for(const auto& config : configs) {
+      auto tag = RAMS7200Tag::make(_ip, config.varName, config.pollTime, config.options, config.valueType);
+      tag->attach(config.hwObject);
+      subscribe(std::move(tag));
+    }
+}
+
+void RAMS7200MS::subscribe(RAMS7200TagHandle tag)
+{
+    std::chrono::milliseconds previousPollTime{0};
+    const auto id = _tags.add(std::move(tag), previousPollTime);
+    if(id == RAMS7200TagTable::NO_TAG) {
+      return;
+    }
+    // The group of the location gets the new subscriber, and if it is faster the location moves to its group
+    _readPlan.invalidate(_tags.pollTime(id));
+    if(previousPollTime.count() > 0 && previousPollTime != _tags.pollTime(id)) {
+      _readPlan.invalidate(previousPollTime);
+    }
+    if(_tags.subscribers(id).size() > 1) {
+      Common::Logger::globalInfo(Common::Logger::L2, __PRETTY_FUNCTION__, (_ip + "$" + _tags.subscribers(id).front()->varName + " read once for " + std::to_string(_tags.subscribers(id).size()) + " addresses").c_str());
+    }
 }
 
-void RAMS7200MS::removeVar(std::string varName)
+void RAMS7200MS::removeVar(const std::string& varName, const HWObject* hwObject)
 {
     std::lock_guard lock{_rwmutex};
-    auto it = vars.find(varName);
-    if(it != vars.end()) {
-      Common::S7Utils::TS7DeallocateDataItem(it->second._toDP);
-      Common::S7Utils::TS7DeallocateDataItem(it->second._toPlc);
-      vars.erase(it);
+    std::chrono::milliseconds previousPollTime{0};
+    if(auto tag = _tags.remove(Common::S7Address::Parse(varName), hwObject, previousPollTime)) {
+      tag->detach();
+      // The location leaves the group it was read with, and moves to a slower one if its fastest subscriber went away
+      _readPlan.invalidate(previousPollTime);
+      const auto id = _tags.find(tag->address);
+      if(id != RAMS7200TagTable::NO_TAG && _tags.pollTime(id) != previousPollTime) {
+        _readPlan.invalidate(_tags.pollTime(id));
+      }
     }
 }
 
 void RAMS7200MS::queuePLCItem(const std::string& varName, void* item)
 {
-  std::lock_guard lock{_rwmutex};
+  {
+    std::lock_guard lock{_rwmutex};
+
+    const auto id = _tags.find(Common::S7Address::Parse(varName));
+    if (id == RAMS7200TagTable::NO_TAG) {
+      Common::Logger::globalWarning(__PRETTY_FUNCTION__, "Undefined variable:", varName.c_str());
+      delete[] static_cast<char*>(item);
+      return;
+    }
+    auto old_data = _tags.setWrite(id, item);
+    if (old_data != nullptr) {
+      delete[] static_cast<char*>(old_data);
+      Common::Logger::globalInfo(Common::Logger::L1, "Overwriting old data for:", CharString(_ip.c_str()) + varName.c_str());
+    }
+  }
 
-  if (vars.count(varName) == 0) {
-    Common::Logger::globalWarning(__PRETTY_FUNCTION__, "Undefined variable:", varName.c_str());
-    delete[] static_cast<char*>(item);
-    return;
+  // Wake up the PLC thread so that the write does not wait for the next poll deadline
+  std::function<void()> wakeUp;
+  {
+    std::lock_guard lock{_threadMutex};
+    _writePending = true;
+    wakeUp = _wakeUp;
   }
-  auto old_data = std::exchange(vars.at(varName)._toPlc.pdata, item);
-  if (old_data != nullptr) {
-    delete[] static_cast<char*>(old_data);
-    Common::Logger::globalInfo(Common::Logger::L1, "Overwriting old data for:", CharString(_ip.c_str()) + varName.c_str());
+  _threadCv.notify_all();
+  if(wakeUp) {
+    wakeUp();
   }
 }
@@ -21,33 +21,43 @@
 #include <atomic>
 #include <mutex>
 #include <condition_variable>
+#include <functional>
 #include "Common/S7Utils.hxx"
 #include "Common/Constants.hxx"
+#include "RAMS7200ReadPlan.hxx"
 #include <tuple>
 #include "CharString.hxx"
+#include "Common/BufferPool.hxx"
+#include "RAMS7200Tag.hxx"
+#include "RAMS7200TagTable.hxx"
 
-using toDPTriple = std::tuple<CharString, uint16_t, char*>;
-using queueToDPCallback = std::function<void(std::vector<toDPTriple>&&)>;
+using toDPTriple = std::tuple<RAMS7200TagHandle, uint16_t, Common::BufferPool::Slice>;
 
-struct RAMS7200MSVar
+// Values queued at once to workProc
+struct RAMS7200ToDPBatch
 {
-    RAMS7200MSVar(std::string varName, int pollTime, TS7DataItem type);
+    std::string source;                                     // IP of the PLC, empty for the values of the driver itself
+    std::vector<toDPTriple> items;
+    std::chrono::system_clock::time_point acquired{};       // when the values were read from the PLC, the epoch if unknown
+    std::chrono::steady_clock::time_point readDone{};       // same instant, for the latency metrics
 
-    const std::string varName;
-    const uint32_t pollTime;
-    std::chrono::steady_clock::time_point lastPollTime{std::chrono::steady_clock::now()};
-    TS7DataItem _toPlc;
-    TS7DataItem _toDP;
-    bool _isString{false};
-   
+    RAMS7200ToDPBatch() = default;
+    RAMS7200ToDPBatch(std::vector<toDPTriple>&& items)
+        : items(std::move(items)), acquired(std::chrono::system_clock::now()), readDone(std::chrono::steady_clock::now()) {}
+    RAMS7200ToDPBatch(std::vector<toDPTriple>&& items, std::chrono::system_clock::time_point acquired, std::chrono::steady_clock::time_point readDone)
+        : items(std::move(items)), acquired(acquired), readDone(readDone) {}
 };
 
-struct DPInfo
+using queueToDPCallback = std::function<void(RAMS7200ToDPBatch&&)>;
+
+// Configuration of an address, as received in addDpPa
+struct RAMS7200MSVarConfig
 {
-    // DP info
-    const std::string dpAddress;
-    const std::string plcAddress;
-    const int dpSize;
+    std::string varName;
+    std::string pollTime;
+    std::string options;
+    RAMS7200ValueType valueType{RAMS7200ValueType::RAW};
+    HWObject* hwObject{nullptr};
 };
 
 class RAMS7200MS
@@ -59,27 +69,42 @@ class RAMS7200MS
         RAMS7200MS& operator=(const RAMS7200MS&) = delete;
         RAMS7200MS(RAMS7200MS&& other) noexcept : _ip(other._ip) {
             if(this == &other) return;
-            vars = std::move(other.vars);
+            _tags = std::move(other._tags);
+            _readPlan = std::move(other._readPlan);
             _run = other._run.load();
         }
         RAMS7200MS& operator=(RAMS7200MS&& other) = delete;
         ~RAMS7200MS() = default;
     protected:    
-        void addVar(std::string varName, int pollTime);
-        void removeVar(std::string varName);
+        void addVar(std::string varName, const std::string& pollTime, const std::string& options = "", RAMS7200ValueType valueType = RAMS7200ValueType::RAW, HWObject* hwObject = nullptr);
+        // Adds many addresses at once (driver startup), taking the lock once
+        void addVars(const std::vector<RAMS7200MSVarConfig>& configs);
+        // Removes the address of an HWObject; the location is still read as long as other addresses point to it
+        void removeVar(const std::string& varName, const HWObject* hwObject);
         const std::string _ip; 
         
         void queuePLCItem(const std::string& varName, void* item);
-        inline bool isEmpty() const {return vars.empty();}
+        inline bool isEmpty() const {return _tags.empty();}
     private: 
-        std::unordered_map<std::string, RAMS7200MSVar> vars;
+        // Adds the tag to the subscribers of its location, under _rwmutex
+        void subscribe(RAMS7200TagHandle tag);
+
+        RAMS7200TagTable _tags;
+        RAMS7200ReadPlan _readPlan;
         std::atomic<bool> _run{false};
+        std::atomic<bool> _sessionDone{false};      // set once the session of the stopped PLC let go of it, so that it can be deleted
+        std::atomic<bool> _writePending{false};     // set by queuePLCItem to wake up the PLC thread
         std::mutex _rwmutex;
         bool previouslyConnected{false};
         std::mutex _threadMutex;
         std::condition_variable _threadCv;
+        std::function<void()> _wakeUp;              // set when the PLC is run by the worker pool, guarded by _threadMutex
 
     friend class RAMS7200LibFacade;
     friend class RAMS7200HWService;
     friend class RAMS7200HWMapper;
+    friend class RAMS7200WorkerPool;
 };
+
+// A PLC taken out of the PLCs of the mapper, kept at the same address until it is deleted
+using RAMS7200MSNode = std::unordered_map<std::string, RAMS7200MS>::node_type;
@@ -0,0 +1,184 @@
+/** © Copyright 2024 CERN
+ *
+ * This software is distributed under the terms of the
+ * GNU Lesser General Public Licence version 3 (LGPL Version 3),
+ * copied verbatim in the file “LICENSE”
+ *
+ * In applying this licence, CERN does not waive the privileges
+ * and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * Author: Alexandru Savulescu (HSE)
+ *
+ **/
+
+#include "RAMS7200ReadPlan.hxx"
+#include "Common/Logger.hxx"
+#include "Common/Constants.hxx"
+#include "Common/ChangeDetector.hxx"
+#include "Common/S7Address.hxx"
+#include <algorithm>
+#include <tuple>
+#include <unordered_map>
+
+
+void RAMS7200ReadPlan::rebuild(std::chrono::milliseconds pollTime, std::vector<RAMS7200ReadPlanEntry>&& entries, int maxGap, size_t pduSize, size_t maxItems, size_t varOverhead, size_t msgOverhead)
+{
+    _dirty.erase(pollTime);
+
+    if(entries.empty()) {
+        _groups.erase(pollTime);
+        return;
+    }
+
+    std::vector<TS7DataItem> items;
+    items.reserve(entries.size());
+    for(const auto& entry : entries) {
+        const auto& item = entry.tag->item;
+        items.emplace_back(Common::S7Coalescer::IsPackableBit(item) ? Common::S7Coalescer::ContainingByte(item) : item);
+    }
+
+    const bool isNew = _groups.count(pollTime) == 0;
+    auto& group = _groups[pollTime];
+    group.pollTime = pollTime;
+    group.period = std::max(pollTime, Common::Constants::getPollingInterval());
+    if(isNew) {
+        group.nextDue = std::chrono::steady_clock::now() + group.period;
+        schedule(group);
+    }
+
+    std::vector<std::vector<size_t>> rangeMembers;
+    group.ranges = Common::S7Coalescer::Coalesce(items, rangeMembers, maxGap, pduSize - msgOverhead - varOverhead - 1);
+    group.batches = Common::S7Coalescer::Pack(group.ranges, maxItems, pduSize, varOverhead, msgOverhead);
+
+    size_t bufferSize = 0;
+    std::vector<size_t> rangeOffsets;
+    rangeOffsets.reserve(group.ranges.size());
+    for(const auto& range : group.ranges) {
+        rangeOffsets.push_back(bufferSize);
+        bufferSize += Common::S7Coalescer::ByteSize(range);
+    }
+    // The locations and subscribers staying in the group keep their mirror and smoothing state, only the new ones start uninitialized
+    auto oldMembers = std::move(group.members);
+    auto oldPrevious = std::move(group.previous);
+    auto oldSent = std::move(group.sent);
+    std::unordered_map<uint64_t, const RAMS7200ReadMember*> oldLocations;
+    oldLocations.reserve(oldMembers.size());
+    for(const auto& member : oldMembers) {
+        oldLocations.emplace(member.tag->address.packed(), &member);
+    }
+    std::vector<std::tuple<size_t, size_t, size_t>> keptSent;   // old offset, new offset and size in sent of the values of the kept subscribers
+
+    group.buffer.assign(Common::ChangeDetector::PaddedSize(bufferSize), 0);
+    group.previous.assign(group.buffer.size(), 0);
+
+    group.members.clear();
+    group.members.reserve(entries.size());
+    group.valuesSize = 0;
+    group.filtered = false;
+    group.fannedOut = false;
+    size_t sentSize = 0;
+    size_t subscribers = 0;
+    for(size_t r = 0; r < group.ranges.size(); ++r) {
+        auto& range = group.ranges[r];
+        range.pdata = group.buffer.data() + rangeOffsets[r];
+        for(const auto idx : rangeMembers[r]) {
+            auto& entry = entries[idx];
+            const bool packedBit = items[idx].WordLen != entry.tag->item.WordLen;
+            const auto bit = packedBit ? entry.tag->item.Start % 8 : -1;
+            const auto size = entry.tag->size;
+            group.members.emplace_back(RAMS7200ReadMember{
+                std::move(entry.tag),
+                r,
+                rangeOffsets[r] + static_cast<size_t>(items[idx].Start - range.Start),
+                size,
+                bit,
+                {}
+            });
+            auto& member = group.members.back();
+            const auto oldIt = oldLocations.find(member.tag->address.packed());
+            const RAMS7200ReadMember* oldMember = oldIt != oldLocations.end() && (oldIt->second->bit < 0) == (bit < 0) ? oldIt->second : nullptr;
+            if(oldMember) {
+                // A bit is mirrored with its whole byte
+                std::memcpy(group.previous.data() + member.offset, oldPrevious.data() + oldMember->offset, bit < 0 ? size : 1);
+            }
+            member.subscribers.reserve(entry.subscribers.size());
+            for(auto& tag : entry.subscribers) {
+                const auto period = std::max(tag->pollTime, group.period);
+                group.filtered = group.filtered || tag->filter.isSet();
+                group.fannedOut = group.fannedOut || period > group.period;
+                member.subscribers.emplace_back(RAMS7200ReadSubscriber{std::move(tag), period, {}, {}, sentSize, false});
+                if(oldMember) {
+                    auto& subscriber = member.subscribers.back();
+                    const auto kept = std::find_if(oldMember->subscribers.begin(), oldMember->subscribers.end(),
+                        [&](const RAMS7200ReadSubscriber& old){ return old.tag == subscriber.tag; });
+                    if(kept != oldMember->subscribers.end()) {
+                        subscriber.nextDue = kept->nextDue;
+                        subscriber.lastSent = kept->lastSent;
+                        subscriber.initialized = kept->initialized;
+                        keptSent.emplace_back(kept->sent, sentSize, size);
+                    }
+                }
+                sentSize += size;
+            }
+            // The subscribers share the value sent to WinCC OA
+            group.valuesSize += size;
+            subscribers += member.subscribers.size();
+        }
+    }
+    group.sent.assign(sentSize, 0);
+    for(const auto& [from, to, size] : keptSent) {
+        std::memcpy(group.sent.data() + to, oldSent.data() + from, size);
+    }
+
+    Common::Logger::globalInfo(Common::Logger::L2, __PRETTY_FUNCTION__, ("Poll time " + std::to_string(pollTime.count()) + "ms: " + std::to_string(group.members.size()) + " locations for " +
+        std::to_string(subscribers) + " addresses in " +
+        std::to_string(group.ranges.size()) + " ranges and " + std::to_string(group.batches.size()) + " requests").c_str());
+}
+
+void RAMS7200ReadPlan::forcePoll(std::chrono::milliseconds pollTime)
+{
+    auto it = _groups.find(pollTime);
+    const auto now = std::chrono::steady_clock::now();
+    if(it != _groups.end() && now < it->second.nextDue) {
+        it->second.nextDue = now;
+        schedule(it->second);
+    }
+}
+
+std::chrono::steady_clock::time_point RAMS7200ReadPlan::nextDeadline()
+{
+    while(!_deadlines.empty() && isStale(_deadlines.top())) {
+        _deadlines.pop();
+    }
+    return _deadlines.empty() ? std::chrono::steady_clock::time_point::max() : _deadlines.top().first;
+}
+
+void RAMS7200ReadPlan::popDue(std::chrono::steady_clock::time_point now, std::vector<RAMS7200ReadGroup*>& due)
+{
+    due.clear();
+    while(nextDeadline() <= now) {
+        auto& group = _groups.at(_deadlines.top().second);
+        _deadlines.pop();
+        due.push_back(&group);
+
+        // Next deadline is planned from the current one. If we are late by more than a period, skip the missed reads.
+        group.nextDue += group.period;
+        if(group.nextDue <= now) {
+            const auto missed = (now - group.nextDue) / group.period + 1;
+            group.nextDue += missed * group.period;
+        }
+        schedule(group);
+    }
+}
+
+void RAMS7200ReadPlan::schedule(RAMS7200ReadGroup& group)
+{
+    _deadlines.emplace(group.nextDue, group.pollTime);
+}
+
+bool RAMS7200ReadPlan::isStale(const Deadline& deadline) const
+{
+    auto it = _groups.find(deadline.second);
+    return it == _groups.end() || it->second.nextDue != deadline.first;
+}
@@ -0,0 +1,185 @@
+/** © Copyright 2024 CERN
+ *
+ * This software is distributed under the terms of the
+ * GNU Lesser General Public Licence version 3 (LGPL Version 3),
+ * copied verbatim in the file “LICENSE”
+ *
+ * In applying this licence, CERN does not waive the privileges
+ * and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * Author: Alexandru Savulescu (HSE)
+ *
+ **/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <queue>
+#include <chrono>
+#include <cstring>
+#include "snap7.h"
+#include "Common/S7Coalescer.hxx"
+#include "RAMS7200Tag.hxx"
+
+/**
+ * @brief A location to be read, as given to RAMS7200ReadPlan::rebuild
+ */
+struct RAMS7200ReadPlanEntry
+{
+    RAMS7200TagHandle tag;                          // any subscriber, giving the S7 coordinates of the location
+    std::vector<RAMS7200TagHandle> subscribers;     // the tags of all the periphery addresses of the location
+};
+
+/**
+ * @brief A periphery address the value of a location is fanned out to, at its own period
+ */
+struct RAMS7200ReadSubscriber
+{
+    RAMS7200TagHandle tag;
+    std::chrono::milliseconds period{0};                    // poll time of the tag, never shorter than the period of the group
+    std::chrono::steady_clock::time_point nextDue{};        // when a subscriber slower than its group takes the next value read
+    std::chrono::steady_clock::time_point lastSent{};       // when a value was last sent (max age)
+    size_t sent{0};                                         // offset of the value last sent in RAMS7200ReadGroup::sent (smoothing)
+    bool initialized{false};                                // whether a value was sent
+
+    // Whether the value read now goes to the subscriber, moving on its next deadline if so
+    bool takes(std::chrono::milliseconds groupPeriod, std::chrono::steady_clock::time_point now)
+    {
+        if(period <= groupPeriod) {
+            return true;
+        }
+        if(now < nextDue) {
+            return false;
+        }
+        nextDue = std::max(nextDue + period, now + period - groupPeriod / 2);
+        return true;
+    }
+};
+
+/**
+ * @brief Where the value of one location ends up after its group has been read, and who gets it
+ */
+struct RAMS7200ReadMember
+{
+    RAMS7200TagHandle tag;  // first subscriber, for the S7 coordinates and the logs
+    size_t range;           // index of the range holding the variable
+    size_t offset;          // offset of the variable data in the group buffer
+    size_t size;            // size in bytes of the variable data
+    int bit;                // for a bit read through its byte, index of the bit in the byte at offset, -1 otherwise
+    std::vector<RAMS7200ReadSubscriber> subscribers;
+
+    // Copies the value of the variable out of a buffer laid out as the group buffer
+    void extract(const char* buffer, char* out) const
+    {
+        if(bit < 0)
+            std::memcpy(out, buffer + offset, size);
+        else
+            *out = Common::S7Coalescer::ExtractBit(buffer[offset], bit);
+    }
+
+    // Copies an extracted value of the variable into a buffer laid out as the group buffer, e.g. a value confirmed after a write
+    void store(const char* value, char* buffer) const
+    {
+        if(bit < 0)
+            std::memcpy(buffer + offset, value, size);
+        else
+            buffer[offset] = static_cast<char>((buffer[offset] & ~(1 << bit)) | ((*value & 1) << bit));
+    }
+
+    bool differs(const char* buffer, const char* other) const
+    {
+        if(bit < 0)
+            return std::memcmp(buffer + offset, other + offset, size) != 0;
+        return ((buffer[offset] ^ other[offset]) >> bit) & 1;
+    }
+
+    // Whether the value of the variable in a buffer laid out as the group buffer differs from an extracted value
+    bool differsFrom(const char* buffer, const char* value) const
+    {
+        if(bit < 0)
+            return std::memcmp(buffer + offset, value, size) != 0;
+        return Common::S7Coalescer::ExtractBit(buffer[offset], bit) != *value;
+    }
+
+};
+
+/**
+ * @brief All the locations read at a poll time (the fastest of their subscribers), compiled into coalesced ranges
+ * packed in multi-var batches, reading into a single preallocated buffer.
+ * Bits are read through their containing byte, so that e.g. V10.0 to V10.7 share a single byte of a range.
+ */
+struct RAMS7200ReadGroup
+{
+    std::chrono::milliseconds pollTime{0};
+    std::chrono::milliseconds period{0};                // pollTime, but never shorter than the polling interval
+    std::chrono::steady_clock::time_point nextDue;      // planned deadline of the next read
+    std::vector<TS7DataItem> ranges;                    // pdata points into buffer
+    std::vector<Common::S7Coalescer::Batch> batches;
+    std::vector<RAMS7200ReadMember> members;
+    std::vector<char> buffer;                           // data of all the ranges, back to back, padded to whole ChangeDetector blocks
+    std::vector<char> previous;                         // mirror of the PLC memory as last read (smoothing), same layout as buffer
+    std::vector<uint64_t> dirty;                        // blocks of buffer that differ from previous, see Common::ChangeDetector
+    std::vector<char> sent;                             // value last sent to each subscriber, back to back (smoothing)
+    bool filtered{false};                               // some subscribers have their own smoothing options
+    bool fannedOut{false};                              // some subscribers are slower than the group
+    size_t valuesSize{0};                               // total size of the values of all the members, as sent to WinCC OA
+};
+
+/**
+ * @brief The compiled read plan of a PLC: one RAMS7200ReadGroup per poll time.
+ * A group is only rebuilt when the set of locations with its poll time, or their subscribers, change.
+ *
+ * The groups are scheduled with a min-heap on their next deadline. A group that was read is
+ * rescheduled from its planned deadline, not from the time the read completed, so that periods don't drift.
+ *
+ * invalidate() is called from addVar/removeVar and rebuild() from the PLC thread, both under RAMS7200MS::_rwmutex.
+ * The groups are only ever accessed by the PLC thread.
+ */
+class RAMS7200ReadPlan
+{
+    public:
+        void invalidate(std::chrono::milliseconds pollTime) { _dirty.insert(pollTime); }
+        // The connection limits changed, all the groups have to be packed again
+        void invalidateAll() { for(const auto& group : _groups) _dirty.insert(group.first); }
+        bool isDirty() const { return !_dirty.empty(); }
+        const std::set<std::chrono::milliseconds>& dirtyPollTimes() const { return _dirty; }
+
+        /**
+         * @brief Rebuilds the group of a poll time from all the locations having it.
+         * The locations already in the group keep their mirror, and their subscribers their smoothing state.
+         * @param pollTime : the poll time of the group
+         * @param entries : the locations of the group, the group is dropped if empty
+         * @param maxGap : see Common::S7Coalescer::Coalesce
+         * @param pduSize : PDU size used to pack the batches
+         * @param maxItems : max items per multi-var request
+         * @param varOverhead : read overhead of each variable
+         * @param msgOverhead : read overhead of the message
+         */
+        void rebuild(std::chrono::milliseconds pollTime, std::vector<RAMS7200ReadPlanEntry>&& entries, int maxGap, size_t pduSize, size_t maxItems, size_t varOverhead, size_t msgOverhead);
+
+        // Makes the group of the poll time due at next Poll
+        void forcePoll(std::chrono::milliseconds pollTime);
+
+        // Deadline of the first group to read, time_point::max() if there is none
+        std::chrono::steady_clock::time_point nextDeadline();
+
+        // Fills due with the groups whose deadline is reached, and reschedules them
+        void popDue(std::chrono::steady_clock::time_point now, std::vector<RAMS7200ReadGroup*>& due);
+
+        std::map<std::chrono::milliseconds, RAMS7200ReadGroup>& groups() { return _groups; }
+
+    private:
+        using Deadline = std::pair<std::chrono::steady_clock::time_point, std::chrono::milliseconds>;
+
+        void schedule(RAMS7200ReadGroup& group);
+        bool isStale(const Deadline& deadline) const;
+
+        std::map<std::chrono::milliseconds, RAMS7200ReadGroup> _groups;
+        std::set<std::chrono::milliseconds> _dirty;
+        // Entries are not removed when a group is dropped or rescheduled earlier, they are skipped once stale
+        std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> _deadlines;
+};
@@ -0,0 +1,94 @@
+/** © Copyright 2024 CERN
+ *
+ * This software is distributed under the terms of the
+ * GNU Lesser General Public Licence version 3 (LGPL Version 3),
+ * copied verbatim in the file “LICENSE”
+ *
+ * In applying this licence, CERN does not waive the privileges
+ * and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * Author: Alexandru Savulescu (HSE)
+ *
+ **/
+
+#include "RAMS7200ReconnectPolicy.hxx"
+#include "Common/Constants.hxx"
+#include <random>
+#include <algorithm>
+
+#define DEFERRED_ATTEMPT_DELAY std::chrono::milliseconds(500)   // when no connection slot is free
+
+std::atomic<int64_t> RAMS7200ReconnectPolicy::_openCircuits{0};
+std::atomic<uint32_t> RAMS7200ReconnectPolicy::_connecting{0};
+
+RAMS7200ReconnectPolicy::~RAMS7200ReconnectPolicy()
+{
+    if(_open) {
+        --_openCircuits;
+    }
+}
+
+void RAMS7200ReconnectPolicy::onSuccess()
+{
+    if(_open) {
+        --_openCircuits;
+    }
+    _open = false;
+    _failures = 0;
+    _nextAttempt = Clock::time_point{};
+}
+
+std::chrono::milliseconds RAMS7200ReconnectPolicy::onFailure(Clock::time_point now)
+{
+    ++_failures;
+    const auto threshold = Common::Constants::getCircuitBreakerThreshold();
+    std::chrono::milliseconds delay;
+    if(threshold > 0 && _failures >= threshold) {
+        if(!_open) {
+            ++_openCircuits;
+        }
+        _open = true;
+        delay = jitter(Common::Constants::getCircuitBreakerPeriod());
+    } else {
+        const auto max = Common::Constants::getReconnectMax();
+        auto backoff = Common::Constants::getReconnectMin();
+        for(uint32_t i = 1; i < _failures && backoff < max; ++i) {
+            backoff *= 2;
+        }
+        delay = jitter(std::min(backoff, max));
+    }
+    _nextAttempt = now + delay;
+    return delay;
+}
+
+void RAMS7200ReconnectPolicy::defer(Clock::time_point now)
+{
+    _nextAttempt = now + jitter(DEFERRED_ATTEMPT_DELAY);
+}
+
+std::chrono::milliseconds RAMS7200ReconnectPolicy::jitter(std::chrono::milliseconds delay)
+{
+    thread_local std::mt19937 generator{std::random_device{}()};
+    std::uniform_int_distribution<long> distribution(delay.count() / 2, delay.count());
+    return std::chrono::milliseconds(distribution(generator));
+}
+
+RAMS7200ReconnectPolicy::Slot::Slot()
+{
+    const auto limit = Common::Constants::getMaxConcurrentConnects();
+    auto connecting = _connecting.load();
+    do {
+        if(limit > 0 && connecting >= limit) {
+            return;
+        }
+    } while(!_connecting.compare_exchange_weak(connecting, connecting + 1));
+    _acquired = true;
+}
+
+RAMS7200ReconnectPolicy::Slot::~Slot()
+{
+    if(_acquired) {
+        --_connecting;
+    }
+}
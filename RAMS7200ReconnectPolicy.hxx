@@ -0,0 +1,76 @@
+/** © Copyright 2024 CERN
+ *
+ * This software is distributed under the terms of the
+ * GNU Lesser General Public Licence version 3 (LGPL Version 3),
+ * copied verbatim in the file “LICENSE”
+ *
+ * In applying this licence, CERN does not waive the privileges
+ * and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * Author: Alexandru Savulescu (HSE)
+ *
+ **/
+
+#pragma once
+
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief When to try to connect again to a PLC.
+ *
+ * The delay between two failed attempts doubles from reconnectMin up to reconnectMax, with a random jitter
+ * so that PLCs lost at the same time do not retry in lockstep. After circuitBreakerThreshold failed attempts
+ * in a row the circuit opens: the PLC is only tried once per circuitBreakerPeriod until it answers again.
+ */
+class RAMS7200ReconnectPolicy
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Time of the next attempt, in the past when the PLC can be tried right away
+    Clock::time_point nextAttempt() const { return _nextAttempt; }
+    bool isOpen() const { return _open; }
+    uint32_t failures() const { return _failures; }
+
+    void onSuccess();
+    // Returns the delay until the next attempt
+    std::chrono::milliseconds onFailure(Clock::time_point now);
+    // No connection slot was free (maxConcurrentConnects): tried again shortly, without counting as a failure
+    void defer(Clock::time_point now);
+
+    // Number of PLCs whose circuit is open, driver wide
+    static int64_t openCircuits() { return _openCircuits.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief One of the maxConcurrentConnects connection attempts allowed at once, driver wide.
+     * Never waits: check whether it was acquired, and release it by destroying it.
+     */
+    class Slot
+    {
+    public:
+        Slot();
+        ~Slot();
+        Slot(const Slot&) = delete;
+        Slot& operator=(const Slot&) = delete;
+        explicit operator bool() const { return _acquired; }
+
+    private:
+        bool _acquired{false};
+    };
+
+    ~RAMS7200ReconnectPolicy();
+
+private:
+    // Random duration in [delay / 2, delay]
+    static std::chrono::milliseconds jitter(std::chrono::milliseconds delay);
+
+    Clock::time_point _nextAttempt{};
+    uint32_t _failures{0};
+    bool _open{false};
+
+    static std::atomic<int64_t> _openCircuits;
+    static std::atomic<uint32_t> _connecting;
+};
@@ -18,6 +18,7 @@
 #include "RAMS7200Resources.hxx"
 #include "Common/Logger.hxx"
 #include "Common/Constants.hxx"
+#include "Common/Utils.hxx"
 #include <ErrHdl.hxx>
 
 const CharString RAMS7200Resources::SECTION_NAME = "rams7200";
@@ -27,6 +28,21 @@ const CharString RAMS7200Resources::POLLING_INTERVAL = "pollingInterval";
 const CharString RAMS7200Resources::SMOOTHING = "smoothing";
 const CharString RAMS7200Resources::MAX_IO_FAILURES = "maxIoFailures";
 const CharString RAMS7200Resources::CYCLE_INTERVAL = "cycleInterval";
+const CharString RAMS7200Resources::COALESCE_GAP = "coalesceGap";
+const CharString RAMS7200Resources::MAX_ITEMS_PER_REQUEST = "maxItemsPerRequest";
+const CharString RAMS7200Resources::PIPELINE_DEPTH = "pipelineDepth";
+const CharString RAMS7200Resources::WRITE_CONFIRMATION = "writeConfirmation";
+const CharString RAMS7200Resources::METRICS_INTERVAL = "metricsInterval";
+const CharString RAMS7200Resources::MAX_AGE = "maxAge";
+const CharString RAMS7200Resources::WORKPROC_BUDGET = "workProcBudget";
+const CharString RAMS7200Resources::WORKPROC_MAX_ITEMS = "workProcMaxItems";
+const CharString RAMS7200Resources::ACQUISITION_TIMESTAMPS = "acquisitionTimestamps";
+const CharString RAMS7200Resources::WORKER_THREADS = "workerThreads";
+const CharString RAMS7200Resources::RECONNECT_MIN = "reconnectMin";
+const CharString RAMS7200Resources::RECONNECT_MAX = "reconnectMax";
+const CharString RAMS7200Resources::MAX_CONCURRENT_CONNECTS = "maxConcurrentConnects";
+const CharString RAMS7200Resources::CIRCUIT_BREAKER_THRESHOLD = "circuitBreakerThreshold";
+const CharString RAMS7200Resources::CIRCUIT_BREAKER_PERIOD = "circuitBreakerPeriod";
 
 //-------------------------------------------------------------------------------
 // init is a wrapper around begin, readSection and end
@@ -43,6 +59,12 @@ void RAMS7200Resources::init(int &argc, char *argv[])
   // Postpass of the commandline arguments, e.g. get the arguments that
   // will override entries in the config file
   end(argc, argv);
+
+  // Pipeline sessions have a thread each, which would make the thread count grow with the number of PLCs again
+  if(Common::Constants::getWorkerThreads() > 0 && Common::Constants::getPipelineDepth() > 1) {
+    Common::Logger::globalWarning("pipelineDepth is not supported with workerThreads, using 1");
+    Common::Constants::setPipelineDepth(1);
+  }
 }
 
 //-------------------------------------------------------------------------------
@@ -69,7 +91,7 @@ PVSSboolean RAMS7200Resources::readSection() {
 				Common::Constants::setRemoteTsapPort(strtol(tmpStr.c_str(), NULL, 16));
 			}else if(keyWord.startsWith(POLLING_INTERVAL)) {
 				cfgStream >> tmpStr;
-				Common::Constants::setPollingInterval(atoi(tmpStr.c_str()));
+				setDuration(tmpStr, POLLING_INTERVAL, Common::Constants::setPollingInterval);
       		}else if(keyWord.startsWith(SMOOTHING)) {
 				cfgStream >> tmpStr;
 				// boolean value
@@ -79,7 +101,76 @@ PVSSboolean RAMS7200Resources::readSection() {
 				Common::Constants::setMaxIoFailures(atoi(tmpStr.c_str()));
 			}else if(keyWord.startsWith(CYCLE_INTERVAL)) {
 				cfgStream >> tmpStr;
-				Common::Constants::setCycleInterval(atoi(tmpStr.c_str()));
+				setDuration(tmpStr, CYCLE_INTERVAL, Common::Constants::setCycleInterval);
+			}else if(keyWord.startsWith(COALESCE_GAP)) {
+				cfgStream >> tmpStr;
+				Common::Constants::setCoalesceGap(atoi(tmpStr.c_str()));
+			}else if(keyWord.startsWith(MAX_ITEMS_PER_REQUEST)) {
+				cfgStream >> tmpStr;
+				const auto maxItems = atoi(tmpStr.c_str());
+				if(maxItems > 0)
+					Common::Constants::setMaxItemsPerRequest(maxItems);
+				else
+					Common::Logger::globalWarning("Invalid value in config file: ", MAX_ITEMS_PER_REQUEST.c_str(), tmpStr.c_str());
+			}else if(keyWord.startsWith(PIPELINE_DEPTH)) {
+				cfgStream >> tmpStr;
+				Common::Constants::setPipelineDepth(std::max(1, atoi(tmpStr.c_str())));
+			}else if(keyWord.startsWith(WRITE_CONFIRMATION)) {
+				cfgStream >> tmpStr;
+				// boolean value
+				Common::Constants::setWriteConfirmation(atoi(tmpStr.c_str()));
+			}else if(keyWord.startsWith(METRICS_INTERVAL)) {
+				cfgStream >> tmpStr;
+				// 0 disables the publication of the metrics
+				const auto interval = Common::Utils::ParseDuration(tmpStr);
+				if(interval.count() >= 0)
+					Common::Constants::setMetricsInterval(interval);
+				else
+					Common::Logger::globalWarning("Invalid duration in config file: ", METRICS_INTERVAL.c_str(), tmpStr.c_str());
+			}else if(keyWord.startsWith(MAX_AGE)) {
+				cfgStream >> tmpStr;
+				// 0 disables the periodic refresh of smoothed values
+				const auto maxAge = Common::Utils::ParseDuration(tmpStr);
+				if(maxAge.count() >= 0)
+					Common::Constants::setMaxAge(maxAge);
+				else
+					Common::Logger::globalWarning("Invalid duration in config file: ", MAX_AGE.c_str(), tmpStr.c_str());
+			}else if(keyWord.startsWith(WORKPROC_BUDGET)) {
+				cfgStream >> tmpStr;
+				// 0 for no time limit
+				const auto budget = Common::Utils::ParseDuration(tmpStr, std::chrono::milliseconds(1));
+				if(budget.count() >= 0)
+					Common::Constants::setWorkProcBudget(budget);
+				else
+					Common::Logger::globalWarning("Invalid duration in config file: ", WORKPROC_BUDGET.c_str(), tmpStr.c_str());
+			}else if(keyWord.startsWith(WORKPROC_MAX_ITEMS)) {
+				cfgStream >> tmpStr;
+				Common::Constants::setWorkProcMaxItems(std::max(0, atoi(tmpStr.c_str())));
+			}else if(keyWord.startsWith(ACQUISITION_TIMESTAMPS)) {
+				cfgStream >> tmpStr;
+				// boolean value
+				Common::Constants::setAcquisitionTimestamps(atoi(tmpStr.c_str()));
+			}else if(keyWord.startsWith(WORKER_THREADS)) {
+				cfgStream >> tmpStr;
+				// 0 for one thread per PLC
+				Common::Constants::setWorkerThreads(std::max(0, atoi(tmpStr.c_str())));
+			}else if(keyWord.startsWith(RECONNECT_MIN)) {
+				cfgStream >> tmpStr;
+				setDuration(tmpStr, RECONNECT_MIN, Common::Constants::setReconnectMin);
+			}else if(keyWord.startsWith(RECONNECT_MAX)) {
+				cfgStream >> tmpStr;
+				setDuration(tmpStr, RECONNECT_MAX, Common::Constants::setReconnectMax);
+			}else if(keyWord.startsWith(MAX_CONCURRENT_CONNECTS)) {
+				cfgStream >> tmpStr;
+				// 0 for no limit
+				Common::Constants::setMaxConcurrentConnects(std::max(0, atoi(tmpStr.c_str())));
+			}else if(keyWord.startsWith(CIRCUIT_BREAKER_THRESHOLD)) {
+				cfgStream >> tmpStr;
+				// 0 disables the circuit breaker
+				Common::Constants::setCircuitBreakerThreshold(std::max(0, atoi(tmpStr.c_str())));
+			}else if(keyWord.startsWith(CIRCUIT_BREAKER_PERIOD)) {
+				cfgStream >> tmpStr;
+				setDuration(tmpStr, CIRCUIT_BREAKER_PERIOD, Common::Constants::setCircuitBreakerPeriod);
 			}else{
 				// Unknown keyword
 				Common::Logger::globalWarning("Unknown keyword in config file: ", keyWord.c_str());
@@ -97,6 +188,18 @@ PVSSboolean RAMS7200Resources::readSection() {
 }
 
 
+void RAMS7200Resources::setDuration(const std::string& value, const CharString& keyword, void (*setter)(std::chrono::milliseconds))
+{
+	// Plain numbers are seconds, for backward compatibility. Use the "ms" suffix for sub-second durations.
+	const auto duration = Common::Utils::ParseDuration(value);
+	if(duration.count() <= 0) {
+		Common::Logger::globalWarning("Invalid duration in config file: ", keyword.c_str(), value.c_str());
+		return;
+	}
+	setter(duration);
+}
+
+
 RAMS7200Resources& RAMS7200Resources::GetInstance()
 {
     static RAMS7200Resources krs;
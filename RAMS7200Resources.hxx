@@ -21,6 +21,8 @@
 //  - Be an interface to internal datapoints
 
 #include <DrvRsrce.hxx>
+#include <string>
+#include <chrono>
 
 class RAMS7200Resources : public DrvRsrce
 {
@@ -39,6 +41,7 @@ class RAMS7200Resources : public DrvRsrce
     void operator= (RAMS7200Resources const&)  = delete;
   private:
     RAMS7200Resources(){}
+    static void setDuration(const std::string& value, const CharString& keyword, void (*setter)(std::chrono::milliseconds));
 
     static const CharString SECTION_NAME;
     static const CharString TSAP_PORT_LOCAL;
@@ -47,6 +50,21 @@ class RAMS7200Resources : public DrvRsrce
     static const CharString SMOOTHING;
     static const CharString MAX_IO_FAILURES;
     static const CharString CYCLE_INTERVAL;
+    static const CharString COALESCE_GAP;
+    static const CharString MAX_ITEMS_PER_REQUEST;
+    static const CharString PIPELINE_DEPTH;
+    static const CharString WRITE_CONFIRMATION;
+    static const CharString METRICS_INTERVAL;
+    static const CharString MAX_AGE;
+    static const CharString WORKPROC_BUDGET;
+    static const CharString WORKPROC_MAX_ITEMS;
+    static const CharString ACQUISITION_TIMESTAMPS;
+    static const CharString WORKER_THREADS;
+    static const CharString RECONNECT_MIN;
+    static const CharString RECONNECT_MAX;
+    static const CharString MAX_CONCURRENT_CONNECTS;
+    static const CharString CIRCUIT_BREAKER_THRESHOLD;
+    static const CharString CIRCUIT_BREAKER_PERIOD;
 };
 
 #endif
@@ -0,0 +1,117 @@
+/** © Copyright 2024 CERN
+ *
+ * This software is distributed under the terms of the
+ * GNU Lesser General Public Licence version 3 (LGPL Version 3),
+ * copied verbatim in the file “LICENSE”
+ *
+ * In applying this licence, CERN does not waive the privileges
+ * and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * Author: Alexandru Savulescu (HSE)
+ *
+ **/
+
+#include "RAMS7200Tag.hxx"
+#include "Common/S7Utils.hxx"
+#include "Common/Utils.hxx"
+#include "Common/Logger.hxx"
+#include <utility>
+#include <cmath>
+#include <cstdlib>
+
+
+bool RAMS7200TagFilter::Parse(const std::string& options, RAMS7200TagFilter& filter)
+{
+    filter = RAMS7200TagFilter();
+    if(options.empty()) {
+        return true;
+    }
+    for(const auto& option : Common::Utils::split(options, ',')) {
+        const auto eq = option.find('=');
+        if(eq == std::string::npos) {
+            return false;
+        }
+        const auto key = option.substr(0, eq);
+        const auto value = option.substr(eq + 1);
+        char* end = nullptr;
+        if(key == "db" || key == "rdb") {
+            const double number = std::strtod(value.c_str(), &end);
+            if(value.empty() || *end != '\0' || number < 0) {
+                return false;
+            }
+            (key == "db" ? filter.deadband : filter.relativeDeadband) = number;
+        } else if(key == "age") {
+            filter.maxAge = Common::Utils::ParseDuration(value);
+            if(filter.maxAge.count() < 0) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+RAMS7200Tag::RAMS7200Tag(std::string varName, std::chrono::milliseconds pollTime, CharString dpAddress, Common::S7Address address, size_t size,
+    RAMS7200ValueType valueType, RAMS7200TagFilter filter)
+    : varName(std::move(varName)), pollTime(pollTime), dpAddress(dpAddress), address(address),
+      item(address.valid() ? Common::S7Utils::TS7DataItemFromAddress(address, false) : TS7DataItem{}),
+      size(size), valueType(valueType), filter(filter)
+{
+}
+
+RAMS7200TagHandle RAMS7200Tag::make(const std::string& ip, const std::string& varName, const std::string& pollTime, const std::string& options, RAMS7200ValueType valueType)
+{
+    const auto address = Common::S7Address::Parse(varName);
+    RAMS7200TagFilter filter;
+    // addDpPa refuses addresses with invalid options, so this only guards other callers: the tag is then polled unfiltered
+    if(!RAMS7200TagFilter::Parse(options, filter)) {
+        Common::Logger::globalWarning("RAMS7200Tag::make: invalid smoothing options, ignored:", options.c_str());
+    }
+    const auto dpAddress = options.empty() ? ip + "$" + varName + "$" + pollTime : ip + "$" + varName + "$" + pollTime + "$" + options;
+    return std::make_shared<const RAMS7200Tag>(
+        varName,
+        Common::Utils::ParseDuration(pollTime),
+        CharString(dpAddress.c_str()),
+        address,
+        Common::S7Utils::DataSizeByte(address.wordLen()) * static_cast<size_t>(address.amount()),
+        valueType,
+        filter
+    );
+}
+
+double RAMS7200Tag::toDouble(const char* value) const
+{
+    switch(valueType) {
+        case RAMS7200ValueType::UINT8:
+            return static_cast<uint8_t>(value[0]);
+        case RAMS7200ValueType::UINT16:
+            return Common::Utils::CopyNSwapBytes<uint16_t>(value);
+        case RAMS7200ValueType::UINT32:
+            return Common::Utils::CopyNSwapBytes<uint32_t>(value);
+        case RAMS7200ValueType::FLOAT:
+            return Common::Utils::CopyNSwapBytes<float>(value);
+        default:
+            return 0;
+    }
+}
+
+bool RAMS7200Tag::exceedsDeadband(const char* value, const char* previous) const
+{
+    if((filter.deadband <= 0 && filter.relativeDeadband <= 0) || valueType == RAMS7200ValueType::RAW) {
+        return true;
+    }
+    const double last = toDouble(previous);
+    const double delta = std::fabs(toDouble(value) - last);
+    if(std::isnan(delta)) {
+        return true;
+    }
+    // Both deadbands have to be exceeded when both are set
+    return delta > filter.deadband && delta > filter.relativeDeadband / 100.0 * std::fabs(last);
+}
+
+RAMS7200TagHandle RAMS7200Tag::makeInternal(const std::string& dpAddress)
+{
+    return std::make_shared<const RAMS7200Tag>("", std::chrono::milliseconds{0}, CharString(dpAddress.c_str()), Common::S7Address(), 0);
+}
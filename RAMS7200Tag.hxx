@@ -0,0 +1,102 @@
+/** © Copyright 2024 CERN
+ *
+ * This software is distributed under the terms of the
+ * GNU Lesser General Public Licence version 3 (LGPL Version 3),
+ * copied verbatim in the file “LICENSE”
+ *
+ * In applying this licence, CERN does not waive the privileges
+ * and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * Author: Alexandru Savulescu (HSE)
+ *
+ **/
+
+#pragma once
+
+#include <string>
+#include <memory>
+#include <chrono>
+#include <atomic>
+#include "snap7.h"
+#include "CharString.hxx"
+#include "Common/S7Address.hxx"
+
+struct RAMS7200Tag;
+class HWObject;
+
+// How to interpret the value of a tag, from the transformation of its periphery address
+enum class RAMS7200ValueType
+{
+    RAW,        // compared byte per byte only
+    UINT8,
+    UINT16,
+    UINT32,
+    FLOAT
+};
+
+/**
+ * @brief Smoothing options of a tag, given as the optional 4th field of the periphery address,
+ * e.g. 10.0.0.1$VD100$1$db=0.5,rdb=2,age=60s
+ */
+struct RAMS7200TagFilter
+{
+    double deadband{0};                         // db: min absolute change of a numeric value to be sent
+    double relativeDeadband{0};                 // rdb: min change to be sent, in percent of the last value sent
+    std::chrono::milliseconds maxAge{0};        // age: the value is sent again after this long even if unchanged, 0 uses the maxAge of the config file
+
+    bool isSet() const { return deadband > 0 || relativeDeadband > 0 || maxAge.count() > 0; }
+
+    // Parses the options of an address, returns false if they are invalid
+    static bool Parse(const std::string& options, RAMS7200TagFilter& filter);
+};
+
+// Interned tag: created once when the address is configured, then shared by the read plan, the toDP queue and workProc
+using RAMS7200TagHandle = std::shared_ptr<const RAMS7200Tag>;
+
+/**
+ * @brief An address handled by the driver, with everything derived from it computed once.
+ * Immutable, so that handles can be passed between threads freely, except for the HWObject of the address
+ * which is only set and used from the WinCC OA main thread (addDpPa, clrDpPa and workProc).
+ */
+struct RAMS7200Tag
+{
+    const std::string varName;                  // PLC address, e.g. VW100
+    const std::chrono::milliseconds pollTime;
+    const CharString dpAddress;                 // periphery address as configured in WinCC OA, e.g. 10.0.0.1$VW100$2
+    const Common::S7Address address;            // parsed varName, its packed value keys the tag table and the read plan
+    const TS7DataItem item;                     // decoded S7 coordinates, pdata unused
+    const size_t size;                          // size in bytes of the value
+    const RAMS7200ValueType valueType;
+    const RAMS7200TagFilter filter;
+
+    /**
+     * @brief Creates the tag of a PLC address
+     * @param ip : IP of the PLC
+     * @param varName : PLC address
+     * @param pollTime : poll time as written in the periphery address, which has to be given back as is to WinCC OA
+     * @param options : smoothing options as written in the periphery address, empty if none
+     * @param valueType : type of the value, used by the deadbands
+     */
+    static RAMS7200TagHandle make(const std::string& ip, const std::string& varName, const std::string& pollTime, const std::string& options = "", RAMS7200ValueType valueType = RAMS7200ValueType::RAW);
+
+    // Creates the tag of an address published by the driver itself (e.g. _VERSION), without S7 coordinates
+    static RAMS7200TagHandle makeInternal(const std::string& dpAddress);
+
+    // Whether a changed value moved enough from the previous one (S7 big-endian data) to get past the deadbands
+    bool exceedsDeadband(const char* value, const char* previous) const;
+
+    double toDouble(const char* value) const;
+
+    // HWObject of the periphery address, so that workProc does not have to look it up for each value. nullptr once detached.
+    HWObject* hwObject() const { return _hwObject.load(std::memory_order_relaxed); }
+    void attach(HWObject* hwObject) const { _hwObject.store(hwObject, std::memory_order_relaxed); }
+    // Called before the HWObject is deleted (clrDpPa): values still queued fall back to a lookup by address
+    void detach() const { _hwObject.store(nullptr, std::memory_order_relaxed); }
+
+    RAMS7200Tag(std::string varName, std::chrono::milliseconds pollTime, CharString dpAddress, Common::S7Address address, size_t size,
+        RAMS7200ValueType valueType = RAMS7200ValueType::RAW, RAMS7200TagFilter filter = RAMS7200TagFilter());
+
+private:
+    mutable std::atomic<HWObject*> _hwObject{nullptr};
+};
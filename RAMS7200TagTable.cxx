@@ -0,0 +1,114 @@
+/** © Copyright 2024 CERN
+ *
+ * This software is distributed under the terms of the
+ * GNU Lesser General Public Licence version 3 (LGPL Version 3),
+ * copied verbatim in the file “LICENSE”
+ *
+ * In applying this licence, CERN does not waive the privileges
+ * and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * Author: Alexandru Savulescu (HSE)
+ *
+ **/
+
+#include "RAMS7200TagTable.hxx"
+#include <utility>
+#include <algorithm>
+
+RAMS7200TagTable::~RAMS7200TagTable()
+{
+    for(auto data : _pendingWrite) {
+        delete[] static_cast<char*>(data);
+    }
+}
+
+void RAMS7200TagTable::reserve(size_t size)
+{
+    _pollTime.reserve(size);
+    _pendingWrite.reserve(size);
+    _subscribers.reserve(size);
+    _index.reserve(size);
+}
+
+RAMS7200TagId RAMS7200TagTable::add(RAMS7200TagHandle tag, std::chrono::milliseconds& previousPollTime)
+{
+    previousPollTime = std::chrono::milliseconds{0};
+    const auto [it, added] = _index.emplace(tag->address.packed(), NO_TAG);
+    if(added) {
+        if(_freeIds.empty()) {
+            it->second = static_cast<RAMS7200TagId>(_subscribers.size());
+            _pollTime.emplace_back(tag->pollTime);
+            _pendingWrite.emplace_back(nullptr);
+            _subscribers.emplace_back();
+        } else {
+            it->second = _freeIds.back();
+            _freeIds.pop_back();
+        }
+    } else {
+        previousPollTime = _pollTime[it->second];
+    }
+    const auto id = it->second;
+    auto& subscribers = _subscribers[id];
+    // Subscribers are told apart by their HWObject: DPEs sharing the same periphery address are distinct subscribers
+    const auto hwObject = tag->hwObject();
+    if(hwObject != nullptr && std::any_of(subscribers.begin(), subscribers.end(), [&](const RAMS7200TagHandle& subscriber){ return subscriber->hwObject() == hwObject; })) {
+        return NO_TAG;
+    }
+    subscribers.emplace_back(std::move(tag));
+    updatePollTime(id);
+    return id;
+}
+
+RAMS7200TagHandle RAMS7200TagTable::remove(Common::S7Address address, const HWObject* hwObject, std::chrono::milliseconds& previousPollTime)
+{
+    auto it = _index.find(address.packed());
+    if(it == _index.end()) {
+        return nullptr;
+    }
+    const auto id = it->second;
+    previousPollTime = _pollTime[id];
+    auto& subscribers = _subscribers[id];
+    auto subscriber = std::find_if(subscribers.begin(), subscribers.end(), [&](const RAMS7200TagHandle& tag){ return tag->hwObject() == hwObject; });
+    if(subscriber == subscribers.end()) {
+        return nullptr;
+    }
+    auto removed = std::move(*subscriber);
+    subscribers.erase(subscriber);
+    if(!subscribers.empty()) {
+        updatePollTime(id);
+        return removed;
+    }
+
+    // Last subscriber: the location goes away
+    _index.erase(it);
+    if(_pendingWrite[id] != nullptr) {
+        delete[] static_cast<char*>(std::exchange(_pendingWrite[id], nullptr));
+        --_pendingWrites;
+    }
+    _freeIds.push_back(id);
+    return removed;
+}
+
+RAMS7200TagId RAMS7200TagTable::find(Common::S7Address address) const
+{
+    auto it = _index.find(address.packed());
+    return it == _index.end() ? NO_TAG : it->second;
+}
+
+void RAMS7200TagTable::updatePollTime(RAMS7200TagId id)
+{
+    const auto& subscribers = _subscribers[id];
+    _pollTime[id] = (*std::min_element(subscribers.begin(), subscribers.end(), [](const RAMS7200TagHandle& a, const RAMS7200TagHandle& b){
+        return a->pollTime < b->pollTime;
+    }))->pollTime;
+}
+
+void* RAMS7200TagTable::setWrite(RAMS7200TagId id, void* data)
+{
+    auto old = std::exchange(_pendingWrite[id], data);
+    if(old == nullptr) {
+        ++_pendingWrites;
+    }
+    return old;
+}
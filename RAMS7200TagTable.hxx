@@ -0,0 +1,104 @@
+/** © Copyright 2024 CERN
+ *
+ * This software is distributed under the terms of the
+ * GNU Lesser General Public Licence version 3 (LGPL Version 3),
+ * copied verbatim in the file “LICENSE”
+ *
+ * In applying this licence, CERN does not waive the privileges
+ * and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * Author: Alexandru Savulescu (HSE)
+ *
+ **/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <unordered_map>
+#include "RAMS7200Tag.hxx"
+#include "Common/S7Address.hxx"
+
+using RAMS7200TagId = uint32_t;
+
+/**
+ * @brief The locations read from a PLC, stored as columns indexed by a dense integer id.
+ *
+ * A location (e.g. VW10) is read once, at the fastest poll time of its subscribers: the tags of all the
+ * periphery addresses pointing to it, counted by reference. The columns walked by the PLC loop (poll time,
+ * pending write) are kept apart from the subscribers, so that scanning them touches a few contiguous bytes per location.
+ * Ids of removed locations are reused. Not thread safe: guarded by the _rwmutex of the PLC.
+ */
+class RAMS7200TagTable
+{
+public:
+    static constexpr RAMS7200TagId NO_TAG = UINT32_MAX;
+
+    RAMS7200TagTable() = default;
+    RAMS7200TagTable(const RAMS7200TagTable&) = delete;
+    RAMS7200TagTable& operator=(const RAMS7200TagTable&) = delete;
+    RAMS7200TagTable(RAMS7200TagTable&&) = default;
+    RAMS7200TagTable& operator=(RAMS7200TagTable&&) = default;
+    // Frees the writes still pending
+    ~RAMS7200TagTable();
+
+    /**
+     * @brief Subscribes the tag to its location, created if needed
+     * @param previousPollTime : set to the poll time of the location before the call, 0 if it is new
+     * @return the id of the location, NO_TAG if a tag of the same HWObject is already subscribed
+     */
+    RAMS7200TagId add(RAMS7200TagHandle tag, std::chrono::milliseconds& previousPollTime);
+
+    /**
+     * @brief Unsubscribes the tag of an HWObject (one subscriber) from a location, which is removed with its last subscriber
+     * @param previousPollTime : set to the poll time of the location before the call
+     * @return the removed tag, nullptr if absent
+     */
+    RAMS7200TagHandle remove(Common::S7Address address, const HWObject* hwObject, std::chrono::milliseconds& previousPollTime);
+
+    RAMS7200TagId find(Common::S7Address address) const;
+
+    // Number of locations
+    size_t size() const { return _index.size(); }
+    bool empty() const { return _index.empty(); }
+    void reserve(size_t size);
+
+    // Ids go from 0 to slots() - 1; a removed location has no subscribers until its id is reused
+    size_t slots() const { return _subscribers.size(); }
+    bool isUsed(RAMS7200TagId id) const { return !_subscribers[id].empty(); }
+    // Poll time of the location: the fastest of its subscribers
+    std::chrono::milliseconds pollTime(RAMS7200TagId id) const { return _pollTime[id]; }
+    const std::vector<RAMS7200TagHandle>& subscribers(RAMS7200TagId id) const { return _subscribers[id]; }
+
+    // Queues data to write to the location, returns the data it replaces (nullptr if none)
+    void* setWrite(RAMS7200TagId id, void* data);
+
+    // Calls f(id, data) for each pending write, handing over the data
+    template <typename F>
+    void takeWrites(F&& f)
+    {
+        for(RAMS7200TagId id = 0; _pendingWrites > 0 && id < _pendingWrite.size(); ++id) {
+            if(_pendingWrite[id] != nullptr) {
+                f(id, std::exchange(_pendingWrite[id], nullptr));
+                --_pendingWrites;
+            }
+        }
+    }
+
+private:
+    void updatePollTime(RAMS7200TagId id);
+
+    // Hot columns
+    std::vector<std::chrono::milliseconds> _pollTime;
+    std::vector<void*> _pendingWrite;       // data queued by writeData, nullptr if none
+    size_t _pendingWrites{0};
+
+    // Cold columns
+    std::vector<std::vector<RAMS7200TagHandle>> _subscribers;
+    std::unordered_map<uint64_t, RAMS7200TagId> _index;     // packed S7Address of the location -> id
+    std::vector<RAMS7200TagId> _freeIds;
+};
@@ -0,0 +1,163 @@
+/** © Copyright 2024 CERN
+ *
+ * This software is distributed under the terms of the
+ * GNU Lesser General Public Licence version 3 (LGPL Version 3),
+ * copied verbatim in the file “LICENSE”
+ *
+ * In applying this licence, CERN does not waive the privileges
+ * and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * Author: Alexandru Savulescu (HSE)
+ *
+ **/
+
+#include "RAMS7200WorkerPool.hxx"
+#include "RAMS7200LibFacade.hxx"
+#include "Common/Logger.hxx"
+#include "Common/Metrics.hxx"
+#include <utility>
+#include <algorithm>
+
+RAMS7200WorkerPool::RAMS7200WorkerPool(size_t threads)
+    : _maxConnecting(std::max<size_t>(1, threads / 2))
+{
+    Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__, ("Starting " + std::to_string(threads) + " worker threads").c_str());
+    for(size_t i = 0; i < threads; ++i) {
+        _workers.emplace_back([this](){ work(); });
+    }
+}
+
+RAMS7200WorkerPool::~RAMS7200WorkerPool()
+{
+    {
+        std::lock_guard lock{_mutex};
+        _stop = true;
+        for(auto& [ms, _] : _sessions) {
+            std::lock_guard msLock{ms->_threadMutex};
+            ms->_wakeUp = nullptr;
+        }
+    }
+    _cv.notify_all();
+    for(auto& worker : _workers) {
+        if(worker.joinable())
+            worker.join();
+    }
+}
+
+void RAMS7200WorkerPool::add(RAMS7200MS& ms, queueToDPCallback cb)
+{
+    {
+        std::lock_guard lock{ms._threadMutex};
+        ms._wakeUp = [this, &ms](){ wakeUp(ms); };
+    }
+    std::lock_guard lock{_mutex};
+    auto& session = _sessions[&ms];
+    if(!session) {
+        Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__, "Worker pool session up for PLC IP" + CharString(ms._ip.c_str()));
+        session.reset(new Session{ms, std::make_unique<RAMS7200LibFacade>(ms, std::move(cb))});
+    }
+    if(session->running) {
+        session->wakeUp = true;
+    } else {
+        schedule(*session, Clock::now());
+    }
+}
+
+bool RAMS7200WorkerPool::stop(RAMS7200MS& ms)
+{
+    std::lock_guard lock{_mutex};
+    auto it = _sessions.find(&ms);
+    if(it == _sessions.end()) {
+        return false;
+    }
+    // A worker drops the session at its next turn: right away if it is waiting, after the iteration in progress otherwise
+    if(!it->second->running) {
+        schedule(*it->second, Clock::now());
+    }
+    return true;
+}
+
+void RAMS7200WorkerPool::wakeUp(RAMS7200MS& ms)
+{
+    std::lock_guard lock{_mutex};
+    auto it = _sessions.find(&ms);
+    if(it == _sessions.end()) {
+        return;
+    }
+    if(it->second->running) {
+        it->second->wakeUp = true;
+    } else {
+        schedule(*it->second, Clock::now());
+    }
+}
+
+void RAMS7200WorkerPool::schedule(Session& session, Clock::time_point time)
+{
+    if(session.queued) {
+        if(session.due->first <= time) {
+            return;
+        }
+        _due.erase(session.due);
+    }
+    session.due = _due.emplace(time, &session);
+    session.queued = true;
+    _cv.notify_one();
+}
+
+void RAMS7200WorkerPool::work()
+{
+    std::unique_lock lock{_mutex};
+    while(!_stop) {
+        if(_due.empty()) {
+            _cv.wait(lock);
+            continue;
+        }
+        const auto now = Clock::now();
+        auto first = _due.begin();
+        if(first->first > now) {
+            _cv.wait_until(lock, first->first);
+            continue;
+        }
+        auto& session = *first->second;
+        const auto due = first->first;
+        _due.erase(first);
+        session.queued = false;
+
+        std::unique_ptr<RAMS7200LibFacade> stopped;
+        if(session.ms._run) {
+            const bool connecting = !session.facade->IsConnected();
+            if(connecting && _connecting >= _maxConnecting) {
+                _connectsDeferred.add();
+                schedule(session, now + CONNECT_RETRY);
+                continue;
+            }
+            _lateness.record(std::chrono::duration_cast<std::chrono::microseconds>(now - due));
+            session.running = true;
+            _connecting += connecting;
+            lock.unlock();
+            const auto next = session.facade->RunOnce();
+            lock.lock();
+            _connecting -= connecting;
+            session.running = false;
+            if(session.ms._run) {
+                schedule(session, std::exchange(session.wakeUp, false) ? Clock::now() : next);
+                continue;
+            }
+        }
+        // The PLC was stopped: its connection is closed outside of the lock, the session still counting as running so that stop() leaves it alone
+        Common::Logger::globalInfo(Common::Logger::L1,__PRETTY_FUNCTION__, "Worker pool session down for PLC IP" + CharString(session.ms._ip.c_str()));
+        {
+            std::lock_guard msLock{session.ms._threadMutex};
+            session.ms._wakeUp = nullptr;
+        }
+        session.running = true;
+        stopped = std::move(session.facade);
+        lock.unlock();
+        stopped.reset();
+        lock.lock();
+        auto& ms = session.ms;
+        _sessions.erase(&ms);
+        ms._sessionDone = true;
+    }
+}
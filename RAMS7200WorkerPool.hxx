@@ -0,0 +1,87 @@
+/** © Copyright 2024 CERN
+ *
+ * This software is distributed under the terms of the
+ * GNU Lesser General Public Licence version 3 (LGPL Version 3),
+ * copied verbatim in the file “LICENSE”
+ *
+ * In applying this licence, CERN does not waive the privileges
+ * and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * Author: Alexandru Savulescu (HSE)
+ *
+ **/
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "RAMS7200MS.hxx"
+#include "Common/Metrics.hxx"
+
+class RAMS7200LibFacade;
+
+/**
+ * @brief Runs the PLCs on a fixed number of worker threads instead of one thread per PLC (workerThreads).
+ *
+ * snap7 only offers blocking calls, so a worker is busy for the duration of one iteration of a PLC loop
+ * (RAMS7200LibFacade::RunOnce). Between two iterations, a PLC costs no thread: it waits in a queue ordered
+ * by the time at which it is due again, and a write queued for it moves it to the front.
+ * Connection attempts, which block for as long as an unreachable PLC takes to time out, run on at most half
+ * of the workers, so that dead PLCs cannot hold all of them.
+ */
+class RAMS7200WorkerPool
+{
+public:
+    RAMS7200WorkerPool(size_t threads);
+    RAMS7200WorkerPool(const RAMS7200WorkerPool&) = delete;
+    RAMS7200WorkerPool& operator=(const RAMS7200WorkerPool&) = delete;
+    // Waits for the iterations in progress
+    ~RAMS7200WorkerPool();
+
+    // Runs the PLC until its _run flag is cleared
+    void add(RAMS7200MS& ms, queueToDPCallback cb);
+    /**
+     * @brief Has a worker drop the session of a stopped PLC (_run cleared), without waiting for its iteration in progress if any.
+     * The PLC can be deleted once its _sessionDone flag is set.
+     * @return false if the PLC has no session
+     */
+    bool stop(RAMS7200MS& ms);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Session
+    {
+        RAMS7200MS& ms;
+        std::unique_ptr<RAMS7200LibFacade> facade;
+        std::multimap<Clock::time_point, Session*>::iterator due{};    // valid while queued
+        bool queued{false};
+        bool running{false};
+        bool wakeUp{false};     // write queued while running: due again as soon as the iteration is done
+    };
+
+    void work();
+    void wakeUp(RAMS7200MS& ms);
+    // Must hold _mutex
+    void schedule(Session& session, Clock::time_point time);
+
+    static constexpr auto CONNECT_RETRY = std::chrono::milliseconds(500);  // a PLC to connect finding no worker for it waits this long
+
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    bool _stop{false};
+    std::map<RAMS7200MS*, std::unique_ptr<Session>> _sessions;
+    std::multimap<Clock::time_point, Session*> _due;
+    const size_t _maxConnecting;    // workers allowed to run PLCs that are not connected
+    size_t _connecting{0};
+    Common::Metrics::Histogram& _lateness{Common::Metrics::histogram("workerPool.lateness")};
+    Common::Metrics::Counter& _connectsDeferred{Common::Metrics::counter("workerPool.connectsDeferred")};
+
+    std::vector<std::thread> _workers;  // last, so that they start once everything else is initialized
+};
@@ -0,0 +1,222 @@
+/** © Copyright 2024 CERN
+ *
+ * This software is distributed under the terms of the
+ * GNU Lesser General Public Licence version 3 (LGPL Version 3),
+ * copied verbatim in the file “LICENSE”
+ *
+ * In applying this licence, CERN does not waive the privileges
+ * and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * Author: Alexandru Savulescu (HSE)
+ *
+ **/
+
+// Benchmark of the single pass S7Address parser against the string based parser it replaced.
+// Checks that both agree on a random corpus of addresses, then times them.
+// Usage: bench_s7address [corpus_size] [repetitions]
+
+#include "Common/S7Utils.hxx"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// The previous S7Utils address parsing, kept verbatim as the reference implementation
+namespace Previous
+{
+    static int AddressGetArea(const std::string& Address)
+    {
+        if(Address.length() < 2){
+            return -1; //invalid
+        }
+        switch(std::toupper(Address[0]))
+        {
+            case 'V': //Data Blocks
+                return S7AreaDB;
+            case 'I':
+            case 'E': //Inputs
+                return S7AreaPE;
+            case 'Q':
+            case 'A': //Outputs
+                return S7AreaPA;
+            case 'M':
+            case 'F': //Flag memory
+                return S7AreaMK;
+            case 'T': //Timers
+                return S7AreaTM;
+            case 'C':
+            case 'Z': //Counters
+                return S7AreaCT;
+            default:
+                return -1; //invalid
+        }
+    }
+
+    static int AddressGetWordLen(const std::string& Address)
+    {
+        if(Address.length() < 2){
+            return -1; //invalid
+        }
+        switch(std::toupper(Address[1]))
+        {
+            case 'B':
+                return S7WLByte;
+            case 'W':
+                return S7WLWord;
+            case 'D':
+                return S7WLReal;     //e.g. VD124 GLB.CAL.GANA1
+            default:
+                return S7WLBit;      //e.g.: V255.3
+        }
+    }
+
+    static int AddressGetStart(const std::string& Address)
+    {
+        if(Address.length() < 2){
+            return -1; //invalid
+        }
+        switch(std::toupper(Address[1]))
+        {
+            case 'B':
+            case 'W':
+            case 'D':
+                //Addesses like XX9999
+                if(Address.find_first_of('.')  == std::string::npos){
+                    return std::stoi(Address.substr(2)); //e.g.:VB2978
+                }
+                return std::stoi(Address.substr(2, Address.find_first_of('.')-1)); //e.g.:VB2978.20
+            default:
+                //Addesses like X9999
+                if(Address.find_first_of('.')  == std::string::npos){
+                    return -1; //invalid
+                }
+                return std::stoi(Address.substr(1, Address.find_first_of('.')-1)); //e.g.: V255.3
+        }
+    }
+
+    static int AddressGetAmount(const std::string& Address)
+    {
+        if(Address.length() < 2){
+            return -1; //invalid
+        }
+        if(std::toupper(Address[1]) == 'B' && Address.find_first_of('.') != std::string::npos){
+            return std::stoi(Address.substr(Address.find('.')+1));
+        }
+        return 1; //default
+    }
+
+    static int AddressGetBit(const std::string& Address)
+    {
+        if(Address.length() < 2){
+            return -1; //invalid
+        }
+        if(AddressGetWordLen(Address) == S7WLBit && Address.find_first_of('.') != std::string::npos){
+            return std::stoi(Address.substr(Address.find('.')+1));
+        }
+        return 0; //default
+    }
+
+    static bool AddressIsValid(const std::string& Address)
+    {
+        return AddressGetArea(Address)!=-1 &&
+        AddressGetWordLen(Address)!=-1 &&
+        AddressGetAmount(Address)!=-1 &&
+        AddressGetStart(Address)!=-1;
+    }
+
+    static TS7DataItem TS7DataItemFromAddress(const std::string& Address)
+    {
+        TS7DataItem item;
+        item.Area     = AddressGetArea(Address);
+        item.WordLen  = AddressGetWordLen(Address);
+        item.DBNumber = 1;
+        item.Start    = item.WordLen == S7WLBit ? (AddressGetStart(Address)*8)+AddressGetBit(Address) : AddressGetStart(Address);
+        item.Amount   = AddressGetAmount(Address);
+        item.Result   = -1;
+        item.pdata    = nullptr;
+        return item;
+    }
+}
+
+static std::vector<std::string> makeCorpus(size_t size)
+{
+    static const char areas[] = "VIQMEAF";
+    static const char* kinds[] = {"B", "W", "D", ""};
+    std::mt19937 gen(1);
+    std::vector<std::string> corpus;
+    corpus.reserve(size);
+    for(size_t i = 0; i < size; i++)
+    {
+        const int kind = gen() % 4;
+        std::string address(1, areas[gen() % 7]);
+        address += kinds[kind];
+        address += std::to_string(gen() % 5000);
+        if(kind == 3)
+            address += "." + std::to_string(gen() % 8);
+        else if(kind == 0 && gen() % 3 == 0)
+            address += "." + std::to_string(1 + gen() % 200);
+        corpus.push_back(std::move(address));
+    }
+    return corpus;
+}
+
+static bool sameItem(const TS7DataItem& a, const TS7DataItem& b)
+{
+    return a.Area == b.Area && a.WordLen == b.WordLen && a.Start == b.Start && a.Amount == b.Amount;
+}
+
+int main(int argc, char** argv)
+{
+    const size_t size = argc > 1 ? std::stoul(argv[1]) : 100000;
+    const int repetitions = argc > 2 ? std::stoi(argv[2]) : 3;
+    const auto corpus = makeCorpus(size);
+
+    size_t mismatches = 0;
+    for(const auto& address : corpus)
+    {
+        const bool valid = Common::S7Utils::AddressIsValid(address);
+        if(valid != Previous::AddressIsValid(address) ||
+           (valid && !sameItem(Common::S7Utils::TS7DataItemFromAddress(address), Previous::TS7DataItemFromAddress(address))))
+        {
+            if(mismatches++ < 10)
+                std::cout << "Mismatch for " << address << std::endl;
+        }
+    }
+    std::cout << "Corpus of " << corpus.size() << " addresses, " << mismatches << " mismatches" << std::endl;
+
+    for(int rep = 0; rep < repetitions; rep++)
+    {
+        long checksum = 0;
+        const auto t0 = std::chrono::steady_clock::now();
+        for(const auto& address : corpus)
+        {
+            if(Previous::AddressIsValid(address))
+                checksum += Previous::TS7DataItemFromAddress(address).Start;
+        }
+        const auto t1 = std::chrono::steady_clock::now();
+        for(const auto& address : corpus)
+        {
+            const auto parsed = Common::S7Address::Parse(address);
+            if(parsed.valid())
+                checksum -= Common::S7Utils::TS7DataItemFromAddress(parsed).Start;
+        }
+        const auto t2 = std::chrono::steady_clock::now();
+        std::cout << "Run " << rep
+                  << ": previous " << std::chrono::duration<double, std::milli>(t1 - t0).count() << "ms"
+                  << ", S7Address " << std::chrono::duration<double, std::milli>(t2 - t1).count() << "ms"
+                  << " (checksum " << checksum << ")" << std::endl;
+    }
+
+    // Addresses the previous parser accepted or threw on, and the new one rejects
+    for(const char* address : {"VB10x", "VW10.2", "VB10.0", "V10.9", "VB-1", "V255"})
+    {
+        bool previous = false;
+        try { previous = Previous::AddressIsValid(address); } catch(const std::exception&) {}
+        std::cout << address << ": previous " << (previous ? "valid" : "invalid")
+                  << ", S7Address " << (Common::S7Utils::AddressIsValid(address) ? "valid" : "invalid") << std::endl;
+    }
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,465 @@
+/** © Copyright 2024 CERN
+ *
+ * This software is distributed under the terms of the
+ * GNU Lesser General Public Licence version 3 (LGPL Version 3),
+ * copied verbatim in the file “LICENSE”
+ *
+ * In applying this licence, CERN does not waive the privileges
+ * and immunities granted to it by virtue of its status as an
+ * Intergovernmental Organization or submit itself to any jurisdiction.
+ *
+ * Author: Alexandru Savulescu (HSE)
+ *
+ **/
+
+// Unit tests of the driver logic that needs no PLC (unlike test.cpp).
+// Usage: unit_test, returns the number of failed checks
+
+#include "Common/S7Coalescer.hxx"
+#include "Common/S7Utils.hxx"
+#include "Common/ChangeDetector.hxx"
+#include "Common/MpscQueue.hxx"
+#include "Common/Constants.hxx"
+#include "RAMS7200ReconnectPolicy.hxx"
+#include "RAMS7200ReadPlan.hxx"
+#include "RAMS7200TagTable.hxx"
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if(!(condition)) { \
+            ++failures; \
+            std::cout << __FILE__ << ":" << __LINE__ << ": " << __func__ << ": CHECK(" #condition ") failed" << std::endl; \
+        } \
+    } while(false)
+
+static std::vector<TS7DataItem> items(std::initializer_list<const char*> addresses)
+{
+    std::vector<TS7DataItem> result;
+    for(const auto address : addresses) {
+        result.emplace_back(Common::S7Utils::TS7DataItemFromAddress(address));
+    }
+    return result;
+}
+
+static void testCoalesceMergesWithinGap()
+{
+    // VB13 is 2 bytes after VW10, VD30 is 16 bytes after VB13
+    const auto vars = items({"VD30", "VW10", "VB13"});
+    std::vector<std::vector<size_t>> members;
+    const auto ranges = Common::S7Coalescer::Coalesce(vars, members, 4, 200);
+    CHECK(ranges.size() == 2);
+    CHECK(ranges[0].Start == 10 && ranges[0].Amount == 4 && ranges[0].WordLen == S7WLByte);
+    CHECK((members[0] == std::vector<size_t>{1, 2}));
+    CHECK(ranges[1].Start == 30 && ranges[1].Amount == 4);
+    CHECK((members[1] == std::vector<size_t>{0}));
+}
+
+static void testCoalesceKeepsAreasApart()
+{
+    const auto vars = items({"VB10", "MB11", "VB11"});
+    std::vector<std::vector<size_t>> members;
+    const auto ranges = Common::S7Coalescer::Coalesce(vars, members, 4, 200);
+    CHECK(ranges.size() == 2);
+    for(size_t r = 0; r < ranges.size(); ++r) {
+        for(const auto idx : members[r]) {
+            CHECK(vars[idx].Area == ranges[r].Area);
+        }
+    }
+}
+
+static void testCoalesceNegativeGapDisablesMerging()
+{
+    const auto vars = items({"VB10", "VB11", "VB12"});
+    std::vector<std::vector<size_t>> members;
+    const auto ranges = Common::S7Coalescer::Coalesce(vars, members, -1, 200);
+    CHECK(ranges.size() == 3);
+}
+
+static void testCoalesceBoundsRangeSize()
+{
+    // 10 contiguous words, ranges of at most 8 bytes
+    const auto vars = items({"VW0", "VW2", "VW4", "VW6", "VW8", "VW10", "VW12", "VW14", "VW16", "VW18"});
+    std::vector<std::vector<size_t>> members;
+    const auto ranges = Common::S7Coalescer::Coalesce(vars, members, 4, 8);
+    CHECK(ranges.size() == 3);
+    size_t covered = 0;
+    for(size_t r = 0; r < ranges.size(); ++r) {
+        CHECK(ranges[r].Amount <= 8);
+        covered += members[r].size();
+    }
+    CHECK(covered == vars.size());
+}
+
+static void testCoalesceWritesOnlyMergesContiguous()
+{
+    auto vars = items({"VW10", "VW12", "VW16"});
+    const char data[3][2] = {{1, 2}, {3, 4}, {5, 6}};
+    for(size_t i = 0; i < vars.size(); ++i) {
+        vars[i].pdata = const_cast<char*>(data[i]);
+    }
+    std::vector<std::vector<size_t>> members;
+    auto ranges = Common::S7Coalescer::CoalesceWrites(vars, members, 200);
+    CHECK(ranges.size() == 2);
+    CHECK(ranges[0].Start == 10 && ranges[0].Amount == 4 && ranges[0].WordLen == S7WLByte);
+    const char* merged = static_cast<const char*>(ranges[0].pdata);
+    CHECK(merged[0] == 1 && merged[1] == 2 && merged[2] == 3 && merged[3] == 4);
+    CHECK(ranges[1].pdata == vars[2].pdata);
+    Common::S7Coalescer::FreeWriteRanges(ranges, members);
+}
+
+static void testPackBoundsPduAndItems()
+{
+    // 10 items of 10 bytes, 4 bytes of overhead each: 14 bytes per item, a PDU of 100 with 20 of message overhead fits 5
+    std::vector<TS7DataItem> vars;
+    for(int i = 0; i < 10; ++i) {
+        vars.emplace_back(Common::S7Utils::TS7DataItemFromAddress("VB" + std::to_string(i * 100) + ".10"));
+    }
+    auto batches = Common::S7Coalescer::Pack(vars, 20, 100, 4, 20);
+    CHECK(batches.size() == 2);
+    for(const auto& batch : batches) {
+        CHECK(batch.count == 5 && !batch.split && batch.bytes < 100);
+    }
+    // The item limit applies first
+    batches = Common::S7Coalescer::Pack(vars, 3, 100, 4, 20);
+    CHECK(batches.size() == 4 && batches[0].count == 3 && batches[3].count == 1);
+}
+
+static void testPackSplitsOversizedItem()
+{
+    const auto vars = items({"VB0.200", "VB300"});
+    const auto batches = Common::S7Coalescer::Pack(vars, 20, 100, 4, 20);
+    CHECK(batches.size() == 2);
+    CHECK(batches[0].split && batches[0].count == 1);
+    CHECK(!batches[1].split && batches[1].first == 1);
+}
+
+static void testBitsFoldIntoTheirByte()
+{
+    const auto bit = Common::S7Utils::TS7DataItemFromAddress("V10.3");
+    CHECK(Common::S7Coalescer::IsPackableBit(bit));
+    const auto byte = Common::S7Coalescer::ContainingByte(bit);
+    CHECK(byte.WordLen == S7WLByte && byte.Start == 10 && byte.Amount == 1);
+    CHECK(Common::S7Coalescer::ExtractBit(0x08, 3) == 1 && Common::S7Coalescer::ExtractBit(static_cast<char>(0xF7), 3) == 0);
+    CHECK(Common::S7Coalescer::ExtractBit(static_cast<char>(0x80), 7) == 1);
+    // Timers and counters have no byte to be read through
+    auto timer = bit;
+    timer.Area = S7AreaTM;
+    CHECK(!Common::S7Coalescer::IsPackableBit(timer));
+
+    // All the bits of a byte and the byte itself share a single range
+    std::vector<TS7DataItem> vars;
+    for(const auto address : {"V10.0", "V10.7", "VB10", "V11.2"}) {
+        const auto item = Common::S7Utils::TS7DataItemFromAddress(address);
+        vars.emplace_back(Common::S7Coalescer::IsPackableBit(item) ? Common::S7Coalescer::ContainingByte(item) : item);
+    }
+    std::vector<std::vector<size_t>> members;
+    const auto ranges = Common::S7Coalescer::Coalesce(vars, members, 0, 200);
+    CHECK(ranges.size() == 1 && ranges[0].Start == 10 && ranges[0].Amount == 2);
+    CHECK(members[0].size() == 4);
+}
+
+static void testChangeDetectorBlockBoundaries()
+{
+    using Common::ChangeDetector;
+    CHECK(ChangeDetector::PaddedSize(0) == 0 && ChangeDetector::PaddedSize(1) == 16 && ChangeDetector::PaddedSize(16) == 16 && ChangeDetector::PaddedSize(17) == 32);
+
+    // 70 blocks: the dirty bitmap spans two words
+    const size_t size = 70 * ChangeDetector::BLOCK_SIZE;
+    std::vector<char> current(size, 0), previous(size, 0);
+    std::vector<uint64_t> dirty;
+    CHECK(!ChangeDetector::Compare(current.data(), previous.data(), size, dirty));
+    CHECK(dirty.size() == 2 && dirty[0] == 0 && dirty[1] == 0);
+
+    // Last byte of block 15, first byte of block 16, and block 64, the first one of the second word
+    current[15 * 16 + 15] = 1;
+    current[16 * 16] = 1;
+    current[64 * 16 + 3] = 1;
+    CHECK(ChangeDetector::Compare(current.data(), previous.data(), size, dirty));
+    CHECK(dirty[0] == ((uint64_t{1} << 15) | (uint64_t{1} << 16)) && dirty[1] == 1);
+
+    CHECK(ChangeDetector::IsDirty(dirty, 15 * 16 + 15, 1));
+    CHECK(!ChangeDetector::IsDirty(dirty, 14 * 16, 16));
+    // A variable straddling two blocks is dirty if either of them is
+    CHECK(ChangeDetector::IsDirty(dirty, 14 * 16 + 14, 4));
+    CHECK(!ChangeDetector::IsDirty(dirty, 17 * 16, 4));
+    CHECK(ChangeDetector::IsDirty(dirty, 64 * 16, 4));
+    CHECK(!ChangeDetector::IsDirty(dirty, 63 * 16, 16));
+}
+
+static void testMpscQueueKeepsProducerOrder()
+{
+    Common::MpscQueue<std::pair<int, int>> queue;
+    std::pair<int, int> value;
+    CHECK(!queue.pop(value));
+
+    constexpr int PRODUCERS = 4;
+    constexpr int VALUES = 20000;
+    std::vector<std::thread> producers;
+    for(int p = 0; p < PRODUCERS; ++p) {
+        producers.emplace_back([&queue, p](){
+            for(int i = 0; i < VALUES; ++i) {
+                queue.push({p, i});
+            }
+        });
+    }
+    // Consumed while the producers push: each producer's values come out in the order it pushed them
+    std::vector<int> next(PRODUCERS, 0);
+    int popped = 0;
+    bool ordered = true;
+    while(popped < PRODUCERS * VALUES) {
+        if(queue.pop(value)) {
+            ordered = ordered && value.second == next[value.first];
+            next[value.first] = value.second + 1;
+            ++popped;
+        }
+    }
+    for(auto& producer : producers) {
+        producer.join();
+    }
+    CHECK(ordered);
+    CHECK(!queue.pop(value));
+}
+
+// Whether delay is in the jitter interval [expected / 2, expected]
+static bool jittered(std::chrono::milliseconds delay, std::chrono::milliseconds expected)
+{
+    return delay >= expected / 2 && delay <= expected;
+}
+
+static void testReconnectBackoffAndBreaker()
+{
+    using namespace std::chrono_literals;
+    Common::Constants::setReconnectMin(100ms);
+    Common::Constants::setReconnectMax(800ms);
+    Common::Constants::setCircuitBreakerThreshold(6);
+    Common::Constants::setCircuitBreakerPeriod(10s);
+    const auto openCircuits = RAMS7200ReconnectPolicy::openCircuits();
+    {
+        RAMS7200ReconnectPolicy policy;
+        const auto now = RAMS7200ReconnectPolicy::Clock::now();
+        CHECK(policy.nextAttempt() <= now && !policy.isOpen());
+
+        // The delay doubles up to reconnectMax
+        for(const auto expected : {100ms, 200ms, 400ms, 800ms, 800ms}) {
+            const auto delay = policy.onFailure(now);
+            CHECK(jittered(delay, expected));
+            CHECK(policy.nextAttempt() == now + delay);
+            CHECK(!policy.isOpen());
+        }
+        // A deferred attempt does not count as a failure
+        policy.defer(now);
+        CHECK(policy.failures() == 5 && policy.nextAttempt() > now);
+
+        // The circuit opens at the threshold, and is only tried once per circuitBreakerPeriod
+        CHECK(jittered(policy.onFailure(now), 10s));
+        CHECK(policy.isOpen() && RAMS7200ReconnectPolicy::openCircuits() == openCircuits + 1);
+        CHECK(jittered(policy.onFailure(now), 10s));
+        CHECK(RAMS7200ReconnectPolicy::openCircuits() == openCircuits + 1);
+
+        // Closed again by a successful connection, starting over from reconnectMin
+        policy.onSuccess();
+        CHECK(!policy.isOpen() && policy.failures() == 0 && policy.nextAttempt() <= now);
+        CHECK(RAMS7200ReconnectPolicy::openCircuits() == openCircuits);
+        CHECK(jittered(policy.onFailure(now), 100ms));
+
+        // A policy deleted with its circuit open does not leave it counted
+        for(int i = 0; i < 6; ++i) {
+            policy.onFailure(now);
+        }
+        CHECK(RAMS7200ReconnectPolicy::openCircuits() == openCircuits + 1);
+    }
+    CHECK(RAMS7200ReconnectPolicy::openCircuits() == openCircuits);
+}
+
+static void testReconnectSlots()
+{
+    Common::Constants::setMaxConcurrentConnects(2);
+    {
+        RAMS7200ReconnectPolicy::Slot first;
+        RAMS7200ReconnectPolicy::Slot second;
+        CHECK(first && second);
+        {
+            RAMS7200ReconnectPolicy::Slot third;
+            CHECK(!third);
+        }
+        // Still 2 taken: a slot that was not acquired does not release one
+        RAMS7200ReconnectPolicy::Slot fourth;
+        CHECK(!fourth);
+    }
+    RAMS7200ReconnectPolicy::Slot released;
+    CHECK(released);
+}
+
+static HWObject* fakeHWObject(uintptr_t n)
+{
+    return reinterpret_cast<HWObject*>(n);
+}
+
+static RAMS7200TagHandle makeTag(const std::string& varName, const std::string& pollTime, uintptr_t hwObject)
+{
+    auto tag = RAMS7200Tag::make("10.0.0.1", varName, pollTime);
+    tag->attach(fakeHWObject(hwObject));
+    return tag;
+}
+
+static void testTagTableReusesIds()
+{
+    using namespace std::chrono_literals;
+    RAMS7200TagTable table;
+    std::chrono::milliseconds previousPollTime;
+    CHECK(table.add(makeTag("VW10", "1", 1), previousPollTime) == 0 && previousPollTime == 0ms);
+    CHECK(table.add(makeTag("VW20", "1", 2), previousPollTime) == 1);
+    CHECK(table.add(makeTag("VW30", "1", 3), previousPollTime) == 2);
+    CHECK(table.size() == 3 && table.slots() == 3);
+
+    // A second address of the same location (however it is written) joins it, and speeds it up
+    CHECK(table.add(makeTag("vw20", "500ms", 4), previousPollTime) == 1);
+    CHECK(previousPollTime == 1000ms && table.pollTime(1) == 500ms && table.subscribers(1).size() == 2);
+    CHECK(table.size() == 3);
+
+    // The location stays as long as it has subscribers, at the poll time of the remaining ones
+    CHECK(table.remove(Common::S7Address::Parse("VW20"), fakeHWObject(4), previousPollTime) != nullptr);
+    CHECK(previousPollTime == 500ms && table.pollTime(1) == 1000ms && table.isUsed(1));
+    CHECK(table.remove(Common::S7Address::Parse("VW20"), fakeHWObject(4), previousPollTime) == nullptr);
+    CHECK(table.remove(Common::S7Address::Parse("VW20"), fakeHWObject(2), previousPollTime) != nullptr);
+    CHECK(!table.isUsed(1) && table.find(Common::S7Address::Parse("VW20")) == RAMS7200TagTable::NO_TAG && table.size() == 2);
+
+    // The id of the removed location is reused, with a clean state
+    CHECK(table.add(makeTag("VD40", "2", 5), previousPollTime) == 1);
+    CHECK(table.slots() == 3 && table.pollTime(1) == 2000ms && table.subscribers(1).size() == 1);
+    CHECK(table.find(Common::S7Address::Parse("VD40")) == 1 && table.find(Common::S7Address::Parse("VW10")) == 0);
+
+    // A write pending on a removed location is dropped with it
+    CHECK(table.setWrite(1, new char[4]) == nullptr);
+    CHECK(table.remove(Common::S7Address::Parse("VD40"), fakeHWObject(5), previousPollTime) != nullptr);
+    int writes = 0;
+    table.takeWrites([&](RAMS7200TagId, void* data){ ++writes; delete[] static_cast<char*>(data); });
+    CHECK(writes == 0);
+}
+
+static void testTagTableKeepsIdenticalAddresses()
+{
+    using namespace std::chrono_literals;
+    Common::Constants::setPollingInterval(100ms);
+    RAMS7200TagTable table;
+    std::chrono::milliseconds previousPollTime;
+    // Two DPEs with the same periphery address
+    const auto first = makeTag("VW10", "1", 1);
+    const auto second = makeTag("VW10", "1", 2);
+    CHECK(first->dpAddress == second->dpAddress);
+    CHECK(table.add(first, previousPollTime) == 0);
+    CHECK(table.add(second, previousPollTime) == 0);
+    // The same DPE configured again is not subscribed twice
+    CHECK(table.add(makeTag("VW10", "1", 2), previousPollTime) == RAMS7200TagTable::NO_TAG);
+    CHECK(table.subscribers(0).size() == 2);
+
+    // Both get the value of the location
+    RAMS7200ReadPlan plan;
+    plan.rebuild(1000ms, {RAMS7200ReadPlanEntry{table.subscribers(0).front(), table.subscribers(0)}}, 4, 240, 20, 12, 19);
+    const auto& member = plan.groups().at(1000ms).members.at(0);
+    CHECK(member.subscribers.size() == 2 && member.subscribers[0].tag->hwObject() != member.subscribers[1].tag->hwObject());
+
+    // Removing one keeps the other alive
+    CHECK(table.remove(Common::S7Address::Parse("VW10"), fakeHWObject(1), previousPollTime) == first);
+    CHECK(table.isUsed(0) && table.find(Common::S7Address::Parse("VW10")) == 0);
+    CHECK(table.subscribers(0).size() == 1 && table.subscribers(0).front() == second);
+    CHECK(table.remove(Common::S7Address::Parse("VW10"), fakeHWObject(2), previousPollTime) == second);
+    CHECK(table.find(Common::S7Address::Parse("VW10")) == RAMS7200TagTable::NO_TAG);
+}
+
+static void testReadPlanSkipsMissedPeriods()
+{
+    using namespace std::chrono_literals;
+    Common::Constants::setPollingInterval(100ms);
+    RAMS7200ReadPlan plan;
+    CHECK(plan.nextDeadline() == std::chrono::steady_clock::time_point::max());
+
+    const auto fast = makeTag("VW10", "100ms", 1);
+    const auto slow = makeTag("VW20", "1", 2);
+    plan.rebuild(100ms, {RAMS7200ReadPlanEntry{fast, {fast}}}, 4, 240, 20, 12, 19);
+    plan.rebuild(1000ms, {RAMS7200ReadPlanEntry{slow, {slow}}}, 4, 240, 20, 12, 19);
+    auto& fastGroup = plan.groups().at(100ms);
+    auto& slowGroup = plan.groups().at(1000ms);
+    const auto first = fastGroup.nextDue;
+    CHECK(plan.nextDeadline() == first && slowGroup.nextDue > first);
+
+    std::vector<RAMS7200ReadGroup*> due;
+    plan.popDue(first - 1ms, due);
+    CHECK(due.empty());
+
+    // Read once when late, the deadline moving on to the next period after now, in step with the first one
+    plan.popDue(first + 250ms, due);
+    CHECK(due.size() == 1 && due[0] == &fastGroup);
+    CHECK(fastGroup.nextDue == first + 300ms);
+    plan.popDue(first + 300ms, due);
+    CHECK(due.size() == 1 && fastGroup.nextDue == first + 400ms);
+
+    // A forced poll is due right away, once
+    plan.forcePoll(1000ms);
+    CHECK(plan.nextDeadline() <= std::chrono::steady_clock::now());
+    plan.popDue(std::chrono::steady_clock::now(), due);
+    CHECK(std::count(due.begin(), due.end(), &slowGroup) == 1);
+
+    // A dropped group leaves no deadline behind
+    plan.rebuild(100ms, {}, 4, 240, 20, 12, 19);
+    CHECK(plan.groups().count(100ms) == 0);
+    CHECK(plan.nextDeadline() == slowGroup.nextDue);
+}
+
+static void testReadPlanPacksBitsAndSubscribers()
+{
+    using namespace std::chrono_literals;
+    Common::Constants::setPollingInterval(100ms);
+    RAMS7200ReadPlan plan;
+    const auto bit0 = makeTag("V10.0", "1", 1);
+    const auto bit5 = makeTag("V10.5", "1", 2);
+    const auto word = makeTag("VW12", "1", 3);
+    const auto wordSlow = makeTag("VW12", "5", 4);
+    plan.rebuild(1000ms, {RAMS7200ReadPlanEntry{bit0, {bit0}}, RAMS7200ReadPlanEntry{bit5, {bit5}}, RAMS7200ReadPlanEntry{word, {word, wordSlow}}}, 4, 240, 20, 12, 19);
+    const auto& group = plan.groups().at(1000ms);
+    CHECK(group.ranges.size() == 1 && group.ranges[0].Start == 10 && group.ranges[0].Amount == 4);
+    CHECK(group.batches.size() == 1 && group.members.size() == 3);
+    CHECK(group.fannedOut && !group.filtered && group.valuesSize == 4);
+    for(const auto& member : group.members) {
+        if(member.tag == bit5) {
+            CHECK(member.offset == 0 && member.bit == 5 && member.size == 1);
+        } else if(member.tag == word) {
+            CHECK(member.offset == 2 && member.bit == -1 && member.size == 2);
+            CHECK(member.subscribers.size() == 2 && member.subscribers[1].period == 5000ms);
+        }
+    }
+    char value;
+    group.members[0].extract("\x21", &value);
+    CHECK(value == 1);
+}
+
+int main()
+{
+    testCoalesceMergesWithinGap();
+    testCoalesceKeepsAreasApart();
+    testCoalesceNegativeGapDisablesMerging();
+    testCoalesceBoundsRangeSize();
+    testCoalesceWritesOnlyMergesContiguous();
+    testPackBoundsPduAndItems();
+    testPackSplitsOversizedItem();
+    testBitsFoldIntoTheirByte();
+    testChangeDetectorBlockBoundaries();
+    testMpscQueueKeepsProducerOrder();
+    testReconnectBackoffAndBreaker();
+    testReconnectSlots();
+    testTagTableReusesIds();
+    testTagTableKeepsIdenticalAddresses();
+    testReadPlanSkipsMissedPeriods();
+    testReadPlanPacksBitsAndSubscribers();
+
+    std::cout << (failures == 0 ? "All checks passed" : std::to_string(failures) + " checks failed") << std::endl;
+    return failures;
+}